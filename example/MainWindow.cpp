@@ -23,19 +23,23 @@
  *
  */
 #include "MainWindow.h"
+#include <QDebug>
 #include <QPushButton>
 #include <QSettings>
+#include <QSplitter>
 #include <QTextEdit>
+#include "ToolWindowManagerArea.h"
 #include "ui_MainWindow.h"
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
   ui->setupUi(this);
   setAttribute(Qt::WA_DeleteOnClose);
-  connect(ui->toolWindowManager, SIGNAL(toolWindowVisibilityChanged(QWidget *, bool)), this,
-          SLOT(toolWindowVisibilityChanged(QWidget *, bool)));
+  ui->toolWindowManager->setToolWindowVisibilitySignalEnabled(false);
+  connect(ui->toolWindowManager, &ToolWindowManager::toolWindowsVisibilityChanged, this,
+          &MainWindow::toolWindowsVisibilityChanged);
 
-  QList<QPushButton *> toolWindows;
+  QList<QWidget *> toolWindows;
   for(int i = 0; i < 6; i++)
   {
     QPushButton *b1 = new QPushButton(QStringLiteral("tool%1").arg(i + 1));
@@ -49,16 +53,15 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     actions << action;
     toolWindows << b1;
   }
-  ui->toolWindowManager->addToolWindow(toolWindows[0], ToolWindowManager::EmptySpace);
-  ui->toolWindowManager->addToolWindow(toolWindows[1], ToolWindowManager::LastUsedArea);
-  ui->toolWindowManager->addToolWindow(toolWindows[2], ToolWindowManager::LastUsedArea);
-  ui->toolWindowManager->addToolWindow(
-      toolWindows[3], ToolWindowManager::AreaReference(
-                          ToolWindowManager::LeftOf, ui->toolWindowManager->areaOf(toolWindows[2])));
-  ui->toolWindowManager->addToolWindow(toolWindows[4], ToolWindowManager::LastUsedArea);
-  ui->toolWindowManager->addToolWindow(
-      toolWindows[5], ToolWindowManager::AreaReference(
-                          ToolWindowManager::TopOf, ui->toolWindowManager->areaOf(toolWindows[4])));
+  // added up front so toolWindows() keeps the order the actions index into, buildLayout() would
+  // add them in the order they appear in the layout
+  ui->toolWindowManager->addToolWindows(toolWindows, ToolWindowManager::NoArea);
+
+  typedef ToolWindowManager::LayoutNode Node;
+  Node left = Node::splitter(Qt::Vertical, {Node::area({toolWindows[5]}),
+                                            Node::area({toolWindows[3], toolWindows[4]}, 1)});
+  Node right = Node::area({toolWindows[0], toolWindows[1], toolWindows[2]}, 2);
+  ui->toolWindowManager->buildLayout(Node::splitter(Qt::Horizontal, {left, right}));
 
   resize(600, 400);
   on_actionRestoreState_triggered();
@@ -77,12 +80,19 @@ void MainWindow::toolWindowActionToggled(bool state)
       toolWindow, state ? ToolWindowManager::LastUsedArea : ToolWindowManager::NoArea);
 }
 
-void MainWindow::toolWindowVisibilityChanged(QWidget *toolWindow, bool visible)
+void MainWindow::toolWindowsVisibilityChanged(const QList<QWidget *> &shown,
+                                              const QList<QWidget *> &hidden)
 {
-  int index = ui->toolWindowManager->toolWindows().indexOf(toolWindow);
-  actions[index]->blockSignals(true);
-  actions[index]->setChecked(visible);
-  actions[index]->blockSignals(false);
+  QList<QWidget *> toolWindows = ui->toolWindowManager->toolWindows();
+  foreach(QAction *action, actions)
+  {
+    QWidget *toolWindow = toolWindows[action->data().toInt()];
+    if(!shown.contains(toolWindow) && !hidden.contains(toolWindow))
+      continue;
+    action->blockSignals(true);
+    action->setChecked(shown.contains(toolWindow));
+    action->blockSignals(false);
+  }
 }
 
 void MainWindow::on_actionSaveState_triggered()
@@ -107,3 +117,42 @@ void MainWindow::on_actionClearState_triggered()
   settings.remove(QStringLiteral("toolWindowManagerState"));
   QApplication::quit();
 }
+
+void MainWindow::on_actionSplitInOneChange_triggered()
+{
+  ToolWindowManager *manager = ui->toolWindowManager;
+  QList<QWidget *> toolWindows = manager->toolWindows();
+  ToolWindowManagerArea *area = manager->areaOf(toolWindows[0]);
+  if(!area)
+  {
+    statusBar()->showMessage(QStringLiteral("tool1 has to be visible"));
+    return;
+  }
+
+  // the second move wraps tool1's area in a new splitter and sets the sizes of the splitter it was
+  // in. Those have to survive the end of the layout change.
+  QSplitter *outer = NULL;
+  QList<int> expected;
+  {
+    ToolWindowManager::LayoutChangeGuard guard(manager);
+    manager->moveToolWindow(toolWindows[1], ToolWindowManager::AreaReference(
+                                                ToolWindowManager::RightOf, area, 0.25f));
+    manager->moveToolWindow(toolWindows[2], ToolWindowManager::AreaReference(
+                                                ToolWindowManager::BottomOf, area, 0.25f));
+    QWidget *inner = area->parentWidget();
+    outer = inner ? qobject_cast<QSplitter *>(inner->parentWidget()) : NULL;
+    if(outer)
+      expected = outer->sizes();
+  }
+
+  if(outer && outer->sizes() != expected)
+  {
+    qWarning() << "splitter sizes changed when the layout change ended:" << expected << "became"
+               << outer->sizes();
+    statusBar()->showMessage(QStringLiteral("splitter sizes were not kept"));
+  }
+  else
+  {
+    statusBar()->showMessage(QStringLiteral("splitter sizes were kept"));
+  }
+}
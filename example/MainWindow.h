@@ -46,10 +46,11 @@ private:
 
 private slots:
   void toolWindowActionToggled(bool state);
-  void toolWindowVisibilityChanged(QWidget *toolWindow, bool visible);
+  void toolWindowsVisibilityChanged(const QList<QWidget *> &shown, const QList<QWidget *> &hidden);
   void on_actionSaveState_triggered();
   void on_actionRestoreState_triggered();
   void on_actionClearState_triggered();
+  void on_actionSplitInOneChange_triggered();
 };
 
 #endif    // MAINWINDOW_H
@@ -12,6 +12,12 @@ TARGET = ToolWindowManager
 TEMPLATE = app
 
 
+# Used to check for a compositor on X11 before drawing translucent drag overlays
+qtHaveModule(x11extras) {
+  QT += x11extras
+  DEFINES += TOOLWINDOWMANAGER_X11EXTRAS
+}
+
 # Disable conversions to/from const char * in QString
 DEFINES += QT_NO_CAST_FROM_ASCII QT_NO_CAST_TO_ASCII
 
@@ -21,6 +27,7 @@ SOURCES += main.cpp\
   MainWindow.cpp \
   ../src/ToolWindowManager.cpp \
     ../src/ToolWindowManagerArea.cpp \
+    ../src/ToolWindowManagerOverlay.cpp \
     ../src/ToolWindowManagerSplitter.cpp \
     ../src/ToolWindowManagerTabBar.cpp \
     ../src/ToolWindowManagerWrapper.cpp
@@ -28,6 +35,7 @@ SOURCES += main.cpp\
 HEADERS  += MainWindow.h \
   ../src/ToolWindowManager.h \
     ../src/ToolWindowManagerArea.h \
+    ../src/ToolWindowManagerOverlay.h \
     ../src/ToolWindowManagerSplitter.h \
     ../src/ToolWindowManagerTabBar.h \
     ../src/ToolWindowManagerWrapper.h
@@ -27,7 +27,9 @@
 #include <QDebug>
 #include <QDesktopWidget>
 #include <QDrag>
+#include <QElapsedTimer>
 #include <QEvent>
+#include <QLabel>
 #include <QMetaMethod>
 #include <QMimeData>
 #include <QMouseEvent>
@@ -35,11 +37,19 @@
 #include <QScreen>
 #include <QSplitter>
 #include <QTabBar>
+#include <QTimer>
 #include <QVBoxLayout>
+#include <QWindow>
+#include <algorithm>
 #include "ToolWindowManagerArea.h"
+#include "ToolWindowManagerOverlay.h"
 #include "ToolWindowManagerSplitter.h"
 #include "ToolWindowManagerWrapper.h"
 
+#ifdef TOOLWINDOWMANAGER_X11EXTRAS
+#include <QX11Info>
+#endif
+
 template <class T>
 T findClosestParent(QWidget *widget)
 {
@@ -54,70 +64,84 @@ T findClosestParent(QWidget *widget)
   return 0;
 }
 
+// tool windows are inside the stacked widget of the area that shows their tab, so the area is
+// always their parent or grandparent
+static ToolWindowManagerArea *tabAreaOf(QWidget *toolWindow)
+{
+  QWidget *parent = toolWindow->parentWidget();
+  ToolWindowManagerArea *area = qobject_cast<ToolWindowManagerArea *>(parent);
+  if(area == NULL && parent)
+    area = qobject_cast<ToolWindowManagerArea *>(parent->parentWidget());
+  return area;
+}
+
+// size in pixels of a cell in the drag hit-test grid
+static const int DragHitCellSize = 128;
+
+static int dragHitCellIndex(int coord)
+{
+  // round towards negative infinity, screens can be placed left of or above the primary screen
+  return coord >= 0 ? coord / DragHitCellSize : -((-coord - 1) / DragHitCellSize) - 1;
+}
+
+static quint64 dragHitCellKey(int cellX, int cellY)
+{
+  return (quint64(quint32(cellX)) << 32) | quint64(quint32(cellY));
+}
+
 ToolWindowManager::ToolWindowManager(QWidget *parent) : QWidget(parent)
 {
   QVBoxLayout *mainLayout = new QVBoxLayout(this);
   mainLayout->setContentsMargins(0, 0, 0, 0);
-  ToolWindowManagerWrapper *wrapper = new ToolWindowManagerWrapper(this, false);
-  wrapper->setWindowFlags(wrapper->windowFlags() & ~Qt::Tool);
-  mainLayout->addWidget(wrapper);
+  m_mainWrapper = new ToolWindowManagerWrapper(this, false);
+  m_mainWrapper->setWindowFlags(m_mainWrapper->windowFlags() & ~Qt::Tool);
+  mainLayout->addWidget(m_mainWrapper);
   m_allowFloatingWindow = true;
   m_createCallback = NULL;
-  m_lastUsedArea = NULL;
+  m_freeToolWindowRecord = -1;
+  m_toolWindowsAdded = 0;
 
   m_draggedWrapper = NULL;
   m_hoverArea = NULL;
+  m_dragHitCacheValid = false;
+  m_dragHitGeneration = 0;
+
+  m_dragUpdateTimer = new QTimer(this);
+  m_dragUpdateTimer->setSingleShot(true);
+  m_dragUpdateTimer->setTimerType(Qt::PreciseTimer);
+  QObject::connect(m_dragUpdateTimer, &QTimer::timeout, this,
+                   &ToolWindowManager::dragUpdateTimeout);
+  m_dragUpdatePending = false;
+  m_dragUpdatesCoalesced = 0;
+  m_dragStatisticsEnabled = false;
+
+  m_toolWindowVisibilitySignalEnabled = true;
+  m_visibilityBatchDepth = 0;
+  m_layoutChangeDepth = 0;
+  m_removalBatchDepth = 0;
+  m_poolCapacity = 8;
 
-  QPalette pal = palette();
-  pal.setColor(QPalette::Background, pal.color(QPalette::Highlight));
-
-  m_previewOverlay = new QWidget(NULL);
-  m_previewOverlay->setAutoFillBackground(true);
-  m_previewOverlay->setPalette(pal);
-  m_previewOverlay->setWindowFlags(Qt::Tool | Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint |
-                                   Qt::X11BypassWindowManagerHint);
-  m_previewOverlay->setWindowOpacity(0.3);
-  m_previewOverlay->setAttribute(Qt::WA_ShowWithoutActivating);
-  m_previewOverlay->setAttribute(Qt::WA_AlwaysStackOnTop);
-  m_previewOverlay->hide();
-
-  m_previewTabOverlay = new QWidget(NULL);
-  m_previewTabOverlay->setAutoFillBackground(true);
-  m_previewTabOverlay->setPalette(pal);
-  m_previewTabOverlay->setWindowFlags(Qt::Tool | Qt::FramelessWindowHint |
-                                      Qt::WindowStaysOnTopHint | Qt::X11BypassWindowManagerHint);
-  m_previewTabOverlay->setWindowOpacity(0.3);
-  m_previewTabOverlay->setAttribute(Qt::WA_ShowWithoutActivating);
-  m_previewTabOverlay->setAttribute(Qt::WA_AlwaysStackOnTop);
-  m_previewTabOverlay->hide();
+  m_dropHotspotDimension = 32;
+  m_dropHotspotMargin = 4;
 
+  m_previewOverlay = m_previewTabOverlay = NULL;
   for(int i = 0; i < NumReferenceTypes; i++)
     m_dropHotspots[i] = NULL;
 
-  m_dropHotspotDimension = 32;
-  m_dropHotspotMargin = 4;
-
   drawHotspotPixmaps();
 
-  for(AreaReferenceType type : {AddTo, TopOf, LeftOf, RightOf, BottomOf, TopWindowSide,
-                                LeftWindowSide, RightWindowSide, BottomWindowSide})
-  {
-    m_dropHotspots[type] = new QLabel(NULL);
-    m_dropHotspots[type]->setWindowFlags(Qt::Tool | Qt::FramelessWindowHint |
-                                         Qt::WindowStaysOnTopHint | Qt::X11BypassWindowManagerHint);
-    m_dropHotspots[type]->setAttribute(Qt::WA_ShowWithoutActivating);
-    m_dropHotspots[type]->setAttribute(Qt::WA_AlwaysStackOnTop);
-    m_dropHotspots[type]->setPixmap(m_pixmaps[type]);
-    m_dropHotspots[type]->setFixedSize(m_dropHotspotDimension, m_dropHotspotDimension);
-  }
+  QObject::connect(qApp, &QGuiApplication::screenRemoved, this, &ToolWindowManager::screenRemoved);
 }
 
 ToolWindowManager::~ToolWindowManager()
 {
+  qDeleteAll(m_overlays);
   delete m_previewOverlay;
   delete m_previewTabOverlay;
   for(QWidget *hotspot : m_dropHotspots)
     delete hotspot;
+  qDeleteAll(m_areaPool);
+  qDeleteAll(m_splitterPool);
   while(!m_areas.isEmpty())
   {
     delete m_areas.first();
@@ -131,7 +155,13 @@ ToolWindowManager::~ToolWindowManager()
 void ToolWindowManager::setToolWindowProperties(QWidget *toolWindow,
                                                 ToolWindowManager::ToolWindowProperty properties)
 {
-  m_toolWindowProperties[toolWindow] = properties;
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  if(!record)
+  {
+    qWarning("unknown tool window");
+    return;
+  }
+  record->properties = properties;
   ToolWindowManagerArea *area = areaOf(toolWindow);
   if(area)
     area->updateToolWindow(toolWindow);
@@ -139,7 +169,99 @@ void ToolWindowManager::setToolWindowProperties(QWidget *toolWindow,
 
 ToolWindowManager::ToolWindowProperty ToolWindowManager::toolWindowProperties(QWidget *toolWindow)
 {
-  return m_toolWindowProperties[toolWindow];
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  return record ? record->properties : ToolWindowProperty(0);
+}
+
+void ToolWindowManager::setToolWindowPersistData(QWidget *toolWindow, const QVariant &data)
+{
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  if(!record)
+  {
+    qWarning("unknown tool window");
+    return;
+  }
+  record->persistData = data;
+  record->hasPersistData = true;
+}
+
+QVariant ToolWindowManager::toolWindowPersistData(QWidget *toolWindow)
+{
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  return record ? recordPersistData(*record) : QVariant();
+}
+
+void ToolWindowManager::restoreToolWindowPersistData(QWidget *toolWindow, const QVariant &data)
+{
+  // the dynamic property is still updated for tool windows that read their data back from it
+  toolWindow->setProperty("persistData", data);
+
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  if(record)
+    record->persistData = data;
+}
+
+QVariant ToolWindowManager::recordPersistData(const ToolWindowRecord &record)
+{
+  // tool windows that never set their data through the manager keep it in the dynamic property
+  return record.hasPersistData ? record.persistData : record.toolWindow->property("persistData");
+}
+
+ToolWindowManager::ToolWindowRecord *ToolWindowManager::toolWindowRecord(QWidget *toolWindow)
+{
+  int handle = m_toolWindowHandles.value(toolWindow, -1);
+  return handle >= 0 ? &m_toolWindowRecords[handle] : NULL;
+}
+
+void ToolWindowManager::addToolWindowRecord(QWidget *toolWindow, ToolWindowProperty properties)
+{
+  int handle = m_freeToolWindowRecord;
+  if(handle >= 0)
+  {
+    m_freeToolWindowRecord = m_toolWindowRecords[handle].nextFree;
+  }
+  else
+  {
+    handle = m_toolWindowRecords.count();
+    m_toolWindowRecords.push_back(ToolWindowRecord());
+  }
+
+  ToolWindowRecord &record = m_toolWindowRecords[handle];
+  record.toolWindow = toolWindow;
+  record.properties = properties;
+  record.area = NULL;
+  record.name = QString();
+  record.addedOrder = m_toolWindowsAdded++;
+  record.persistData = QVariant();
+  record.hasPersistData = false;
+  record.nextFree = -1;
+
+  m_toolWindows << toolWindow;
+  m_toolWindowHandles[toolWindow] = handle;
+  indexToolWindowName(record, toolWindow->objectName());
+
+  QObject::connect(toolWindow, &QWidget::windowTitleChanged, this,
+                   &ToolWindowManager::windowTitleChanged);
+  QObject::connect(toolWindow, &QObject::objectNameChanged, this,
+                   &ToolWindowManager::toolWindowNameChanged);
+}
+
+void ToolWindowManager::removeToolWindowRecord(QWidget *toolWindow)
+{
+  int handle = m_toolWindowHandles.take(toolWindow);
+  ToolWindowRecord &record = m_toolWindowRecords[handle];
+
+  m_toolWindows.removeOne(toolWindow);
+  m_visibilityChanged.removeAll(toolWindow);
+  unindexToolWindowName(record);
+  QObject::disconnect(toolWindow, &QWidget::windowTitleChanged, this,
+                      &ToolWindowManager::windowTitleChanged);
+  QObject::disconnect(toolWindow, &QObject::objectNameChanged, this,
+                      &ToolWindowManager::toolWindowNameChanged);
+
+  record = ToolWindowRecord();
+  record.nextFree = m_freeToolWindowRecord;
+  m_freeToolWindowRecord = handle;
 }
 
 void ToolWindowManager::addToolWindow(QWidget *toolWindow, const AreaReference &area,
@@ -152,6 +274,16 @@ void ToolWindowManager::addToolWindows(QList<QWidget *> toolWindows,
                                        const ToolWindowManager::AreaReference &area,
                                        ToolWindowManager::ToolWindowProperty properties)
 {
+  int capacity = m_toolWindows.count() + toolWindows.count();
+  m_toolWindows.reserve(capacity);
+  m_toolWindowHandles.reserve(capacity);
+  if(m_freeToolWindowRecord < 0)
+    m_toolWindowRecords.reserve(capacity);
+
+  QList<QWidget *> added;
+  added.reserve(toolWindows.count());
+  QSet<QWidget *> seen;
+  seen.reserve(toolWindows.count());
   foreach(QWidget *toolWindow, toolWindows)
   {
     if(!toolWindow)
@@ -159,29 +291,40 @@ void ToolWindowManager::addToolWindows(QList<QWidget *> toolWindows,
       qWarning("cannot add null widget");
       continue;
     }
-    if(m_toolWindows.contains(toolWindow))
+    if(isToolWindow(toolWindow) || seen.contains(toolWindow))
     {
       qWarning("this tool window has already been added");
       continue;
     }
-    toolWindow->hide();
-    toolWindow->setParent(0);
-    m_toolWindows << toolWindow;
-    m_toolWindowProperties[toolWindow] = properties;
-    QObject::connect(toolWindow, &QWidget::windowTitleChanged, this,
-                     &ToolWindowManager::windowTitleChanged);
+    seen.insert(toolWindow);
+
+    // widgets that were never shown or parented don't need either call, and both are costly
+    if(!toolWindow->isHidden())
+      toolWindow->hide();
+    if(toolWindow->parentWidget())
+      toolWindow->setParent(0);
+    addToolWindowRecord(toolWindow, properties);
+    added << toolWindow;
   }
-  moveToolWindows(toolWindows, area);
+
+  if(added.isEmpty())
+    return;
+
+  // the new tool windows are known and not in any area, so the checks in moveToolWindows() and
+  // the release of each tool window from its old area are skipped
+  placeToolWindows(added, area, QList<ToolWindowManagerWrapper *>());
 }
 
 ToolWindowManagerArea *ToolWindowManager::areaOf(QWidget *toolWindow)
 {
-  return findClosestParent<ToolWindowManagerArea *>(toolWindow);
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  return record ? record->area : NULL;
 }
 
 ToolWindowManagerWrapper *ToolWindowManager::wrapperOf(QWidget *toolWindow)
 {
-  return findClosestParent<ToolWindowManagerWrapper *>(toolWindow);
+  ToolWindowManagerArea *area = areaOf(toolWindow);
+  return area ? area->wrapper() : NULL;
 }
 
 void ToolWindowManager::moveToolWindow(QWidget *toolWindow, AreaReference area)
@@ -195,30 +338,28 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
   QList<ToolWindowManagerWrapper *> wrappersToUpdate;
   foreach(QWidget *toolWindow, toolWindows)
   {
-    if(!m_toolWindows.contains(toolWindow))
+    if(!isToolWindow(toolWindow))
     {
       qWarning("unknown tool window");
       return;
     }
     ToolWindowManagerWrapper *oldWrapper = wrapperOf(toolWindow);
-    if(toolWindow->parentWidget() != 0)
+    if(areaOf(toolWindow))
     {
       releaseToolWindow(toolWindow);
     }
     if(oldWrapper && !wrappersToUpdate.contains(oldWrapper))
       wrappersToUpdate.push_back(oldWrapper);
   }
-  if(area.type() == LastUsedArea && !m_lastUsedArea)
+  placeToolWindows(toolWindows, area, wrappersToUpdate);
+}
+
+void ToolWindowManager::placeToolWindows(const QList<QWidget *> &toolWindows, AreaReference area,
+                                         QList<ToolWindowManagerWrapper *> wrappersToUpdate)
+{
+  if(area.type() == LastUsedArea && !lastUsedArea())
   {
-    ToolWindowManagerArea *foundArea = findChild<ToolWindowManagerArea *>();
-    if(foundArea)
-    {
-      area = AreaReference(AddTo, foundArea);
-    }
-    else
-    {
-      area = EmptySpace;
-    }
+    area = EmptySpace;
   }
 
   if(area.type() == NoArea)
@@ -232,8 +373,8 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
     floatArea->addToolWindows(toolWindows);
     wrapper->layout()->addWidget(floatArea);
     wrapper->move(QCursor::pos());
-    wrapper->updateTitle();
-    wrapper->show();
+    // its title is updated with the other wrappers below
+    showFloatingWrapper(wrapper);
   }
   else if(area.type() == AddTo)
   {
@@ -247,7 +388,7 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
   else if(area.type() == LeftWindowSide || area.type() == RightWindowSide ||
           area.type() == TopWindowSide || area.type() == BottomWindowSide)
   {
-    ToolWindowManagerWrapper *wrapper = findClosestParent<ToolWindowManagerWrapper *>(area.area());
+    ToolWindowManagerWrapper *wrapper = area.area()->wrapper();
     if(!wrapper)
     {
       qWarning("couldn't find wrapper");
@@ -265,11 +406,11 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
     QSplitter *splitter = createSplitter();
     if(area.type() == TopWindowSide || area.type() == BottomWindowSide)
     {
-      splitter->setOrientation(Qt::Vertical);
+      setSplitterOrientation(splitter, Qt::Vertical);
     }
     else
     {
-      splitter->setOrientation(Qt::Horizontal);
+      setSplitterOrientation(splitter, Qt::Horizontal);
     }
 
     splitter->addWidget(item->widget());
@@ -324,7 +465,7 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
     if(parentSplitter)
     {
       indexInParentSplitter = parentSplitter->indexOf(area.widget());
-      parentSplitterSizes = parentSplitter->sizes();
+      parentSplitterSizes = splitterSizes(parentSplitter);
       if(parentSplitter->orientation() == Qt::Vertical)
       {
         useParentSplitter = area.type() == TopOf || area.type() == BottomOf;
@@ -352,7 +493,7 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
         parentSplitterSizes[indexInParentSplitter] = int(availSize * (1.0f - area.percentage()));
         parentSplitterSizes.insert(insertIndex, int(availSize * area.percentage()));
 
-        parentSplitter->setSizes(parentSplitterSizes);
+        setSplitterSizes(parentSplitter, parentSplitterSizes);
       }
     }
     else
@@ -362,11 +503,11 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
       QSplitter *splitter = createSplitter();
       if(area.type() == TopOf || area.type() == BottomOf)
       {
-        splitter->setOrientation(Qt::Vertical);
+        setSplitterOrientation(splitter, Qt::Vertical);
       }
       else
       {
-        splitter->setOrientation(Qt::Horizontal);
+        setSplitterOrientation(splitter, Qt::Horizontal);
       }
 
       ToolWindowManagerArea *newArea = createArea(splitter);
@@ -396,7 +537,7 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
 
         if(parentSplitterSizes.count() > 0 && parentSplitterSizes[0] != 0)
         {
-          parentSplitter->setSizes(parentSplitterSizes);
+          setSplitterSizes(parentSplitter, parentSplitterSizes);
         }
       }
       else
@@ -427,25 +568,112 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
   else if(area.type() == EmptySpace)
   {
     ToolWindowManagerArea *newArea = createArea();
-    findChild<ToolWindowManagerWrapper *>()->layout()->addWidget(newArea);
+    m_mainWrapper->layout()->addWidget(newArea);
     newArea->addToolWindows(toolWindows);
   }
   else if(area.type() == LastUsedArea)
   {
-    m_lastUsedArea->addToolWindows(toolWindows);
+    lastUsedArea()->addToolWindows(toolWindows);
   }
   else
   {
     qWarning("invalid type");
   }
-  simplifyLayout();
   foreach(QWidget *toolWindow, toolWindows)
   {
-    emit toolWindowVisibilityChanged(toolWindow, toolWindow->parent() != 0);
     ToolWindowManagerWrapper *wrapper = wrapperOf(toolWindow);
     if(wrapper && !wrappersToUpdate.contains(wrapper))
       wrappersToUpdate.push_back(wrapper);
   }
+  layoutChanged(wrappersToUpdate);
+  visibilityMayHaveChanged(toolWindows);
+}
+
+void ToolWindowManager::beginLayoutChange()
+{
+  if(m_layoutChangeDepth++ > 0)
+    return;
+
+  beginVisibilityBatch();
+  beginRemovalBatch();
+  foreach(ToolWindowManagerWrapper *wrapper, m_wrappers)
+  {
+    if(wrapper->updatesEnabled())
+    {
+      wrapper->setUpdatesEnabled(false);
+      m_layoutChangeUpdatesDisabled << wrapper;
+    }
+  }
+}
+
+void ToolWindowManager::commitLayoutChange()
+{
+  if(m_layoutChangeDepth == 0)
+  {
+    qWarning("no layout change in progress");
+    return;
+  }
+  if(--m_layoutChangeDepth > 0)
+    return;
+
+  QList<ToolWindowManagerWrapper *> wrappersToUpdate;
+  foreach(const QPointer<ToolWindowManagerWrapper> &wrapper, m_layoutChangeTitles)
+  {
+    if(wrapper)
+      wrappersToUpdate << wrapper.data();
+  }
+  m_layoutChangeTitles.clear();
+  layoutChanged(wrappersToUpdate);
+  endRemovalBatch();
+
+  foreach(const QPointer<ToolWindowManagerWrapper> &wrapper, m_layoutChangeUpdatesDisabled)
+  {
+    if(wrapper)
+      wrapper->setUpdatesEnabled(true);
+  }
+  m_layoutChangeUpdatesDisabled.clear();
+
+  // floating wrappers that were left empty have been hidden and are being deleted
+  QList<QPointer<ToolWindowManagerWrapper>> shows = m_layoutChangeShows;
+  m_layoutChangeShows.clear();
+  foreach(const QPointer<ToolWindowManagerWrapper> &wrapper, shows)
+  {
+    if(wrapper && wrapper->layout()->count() > 0)
+      showFloatingWrapper(wrapper);
+  }
+
+  endVisibilityBatch();
+}
+
+void ToolWindowManager::showFloatingWrapper(ToolWindowManagerWrapper *wrapper)
+{
+  if(m_layoutChangeDepth > 0)
+  {
+    m_layoutChangeShows << wrapper;
+    return;
+  }
+
+  wrapper->show();
+  if(wrapper->windowState() & Qt::WindowMaximized)
+  {
+    wrapper->setWindowState(0);
+    wrapper->setWindowState(Qt::WindowMaximized);
+  }
+}
+
+void ToolWindowManager::layoutChanged(const QList<ToolWindowManagerWrapper *> &wrappersToUpdate)
+{
+  if(m_layoutChangeDepth > 0)
+  {
+    foreach(ToolWindowManagerWrapper *wrapper, wrappersToUpdate)
+    {
+      if(!m_layoutChangeTitles.contains(wrapper))
+        m_layoutChangeTitles << wrapper;
+    }
+    return;
+  }
+
+  simplifyLayout();
   foreach(ToolWindowManagerWrapper *wrapper, wrappersToUpdate)
   {
     wrapper->updateTitle();
@@ -454,14 +682,13 @@ void ToolWindowManager::moveToolWindows(QList<QWidget *> toolWindows,
 
 void ToolWindowManager::removeToolWindow(QWidget *toolWindow, bool allowCloseAlreadyChecked)
 {
-  if(!m_toolWindows.contains(toolWindow))
+  if(!isToolWindow(toolWindow))
   {
     qWarning("unknown tool window");
     return;
   }
 
-  // search up to find the first parent manager
-  ToolWindowManager *manager = findClosestParent<ToolWindowManager *>(toolWindow);
+  ToolWindowManager *manager = managerOf(toolWindow);
 
   if(!manager)
   {
@@ -476,8 +703,7 @@ void ToolWindowManager::removeToolWindow(QWidget *toolWindow, bool allowCloseAlr
   }
 
   moveToolWindow(toolWindow, NoArea);
-  m_toolWindows.removeOne(toolWindow);
-  m_toolWindowProperties.remove(toolWindow);
+  removeToolWindowRecord(toolWindow);
   delete toolWindow;
 }
 
@@ -499,6 +725,13 @@ ToolWindowManager *ToolWindowManager::managerOf(QWidget *toolWindow)
     return NULL;
   }
 
+  // areas know their manager, so only look further up for widgets that aren't in an area
+  ToolWindowManagerArea *area = qobject_cast<ToolWindowManagerArea *>(toolWindow);
+  if(area == NULL)
+    area = tabAreaOf(toolWindow);
+  if(area)
+    return area->manager();
+
   return findClosestParent<ToolWindowManager *>(toolWindow);
 }
 
@@ -510,8 +743,7 @@ void ToolWindowManager::closeToolWindow(QWidget *toolWindow)
     return;
   }
 
-  // search up to find the first parent manager
-  ToolWindowManager *manager = findClosestParent<ToolWindowManager *>(toolWindow);
+  ToolWindowManager *manager = managerOf(toolWindow);
 
   if(manager)
   {
@@ -531,12 +763,7 @@ void ToolWindowManager::raiseToolWindow(QWidget *toolWindow)
   }
 
   // if the parent is a ToolWindowManagerArea, switch tabs
-  QWidget *parent = toolWindow->parentWidget();
-  ToolWindowManagerArea *area = qobject_cast<ToolWindowManagerArea *>(parent);
-  if(area == NULL && parent)
-    parent = parent->parentWidget();
-
-  area = qobject_cast<ToolWindowManagerArea *>(parent);
+  ToolWindowManagerArea *area = tabAreaOf(toolWindow);
 
   if(area)
     area->setCurrentWidget(toolWindow);
@@ -551,10 +778,7 @@ QWidget *ToolWindowManager::createToolWindow(const QString &objectName)
     QWidget *toolWindow = m_createCallback(objectName);
     if(toolWindow)
     {
-      m_toolWindows << toolWindow;
-      m_toolWindowProperties[toolWindow] = ToolWindowProperty(0);
-      QObject::connect(toolWindow, &QWidget::windowTitleChanged, this,
-                       &ToolWindowManager::windowTitleChanged);
+      addToolWindowRecord(toolWindow, ToolWindowProperty(0));
       return toolWindow;
     }
   }
@@ -571,12 +795,6 @@ void ToolWindowManager::setDropHotspotMargin(int pixels)
 void ToolWindowManager::setDropHotspotDimension(int pixels)
 {
   m_dropHotspotDimension = pixels;
-
-  for(QLabel *hotspot : m_dropHotspots)
-  {
-    if(hotspot)
-      hotspot->setFixedSize(m_dropHotspotDimension, m_dropHotspotDimension);
-  }
 }
 
 void ToolWindowManager::setAllowFloatingWindow(bool allow)
@@ -588,13 +806,7 @@ QVariantMap ToolWindowManager::saveState()
 {
   QVariantMap result;
   result[QStringLiteral("toolWindowManagerStateFormat")] = 1;
-  ToolWindowManagerWrapper *mainWrapper = findChild<ToolWindowManagerWrapper *>();
-  if(!mainWrapper)
-  {
-    qWarning("can't find main wrapper");
-    return QVariantMap();
-  }
-  result[QStringLiteral("mainWrapper")] = mainWrapper->saveState();
+  result[QStringLiteral("mainWrapper")] = m_mainWrapper->saveState();
   QVariantList floatingWindowsData;
   foreach(ToolWindowManagerWrapper *wrapper, m_wrappers)
   {
@@ -619,34 +831,65 @@ void ToolWindowManager::restoreState(const QVariantMap &dataMap)
     qWarning("state format is not recognized");
     return;
   }
+  // the tool windows are hidden and then shown again. Simplifying, titles and the visibility
+  // signals are left to the end, and restored floating windows are shown once they're complete.
+  LayoutChangeGuard guard(this);
   moveToolWindows(m_toolWindows, NoArea);
-  ToolWindowManagerWrapper *mainWrapper = findChild<ToolWindowManagerWrapper *>();
-  if(!mainWrapper)
-  {
-    qWarning("can't find main wrapper");
-    return;
-  }
-  mainWrapper->restoreState(dataMap[QStringLiteral("mainWrapper")].toMap());
+  m_mainWrapper->restoreState(dataMap[QStringLiteral("mainWrapper")].toMap());
   QVariantList floatWins = dataMap[QStringLiteral("floatingWindows")].toList();
   foreach(QVariant windowData, floatWins)
   {
     ToolWindowManagerWrapper *wrapper = new ToolWindowManagerWrapper(this, true);
     wrapper->restoreState(windowData.toMap());
-    wrapper->updateTitle();
-    wrapper->show();
-    if(wrapper->windowState() & Qt::WindowMaximized)
-    {
-      wrapper->setWindowState(0);
-      wrapper->setWindowState(Qt::WindowMaximized);
-    }
+    layoutChanged(QList<ToolWindowManagerWrapper *>() << wrapper);
+    showFloatingWrapper(wrapper);
   }
-  simplifyLayout();
-  foreach(QWidget *toolWindow, m_toolWindows)
+  visibilityMayHaveChanged(m_toolWindows);
+}
+
+void ToolWindowManager::visibilityMayHaveChanged(const QList<QWidget *> &toolWindows)
+{
+  m_visibilityChanged << toolWindows;
+  if(m_visibilityBatchDepth == 0)
   {
-    emit toolWindowVisibilityChanged(toolWindow, toolWindow->parentWidget() != 0);
+    beginVisibilityBatch();
+    endVisibilityBatch();
   }
 }
 
+void ToolWindowManager::endVisibilityBatch()
+{
+  if(--m_visibilityBatchDepth > 0 || m_visibilityChanged.isEmpty())
+    return;
+
+  QList<QWidget *> changed = m_visibilityChanged;
+  m_visibilityChanged.clear();
+
+  QList<QWidget *> shown, hidden;
+  QSet<QWidget *> seen;
+  foreach(QWidget *toolWindow, changed)
+  {
+    if(seen.contains(toolWindow))
+      continue;
+    seen.insert(toolWindow);
+
+    // hiding removes the tab without reparenting the tool window, so its parent tells nothing.
+    // The record's area does, and it has to agree with the area's tabs.
+    ToolWindowManagerArea *area = areaOf(toolWindow);
+    bool visible = area != NULL;
+#ifndef QT_NO_DEBUG
+    if(area && area->indexOf(toolWindow) < 0)
+      qWarning("tool window is recorded in an area that has no tab for it");
+    else if(!area && !toolWindow->isHidden())
+      qWarning("tool window is reported hidden but is still shown");
+#endif
+    if(m_toolWindowVisibilitySignalEnabled)
+      emit toolWindowVisibilityChanged(toolWindow, visible);
+    (visible ? shown : hidden) << toolWindow;
+  }
+  emit toolWindowsVisibilityChanged(shown, hidden);
+}
+
 ToolWindowManagerArea *ToolWindowManager::createArea(QWidget *owner)
 {
   if(nullptr == owner)
@@ -654,169 +897,533 @@ ToolWindowManagerArea *ToolWindowManager::createArea(QWidget *owner)
     owner = this;
   }
 
+  if(!m_areaPool.isEmpty())
+  {
+    m_poolStatistics.areaHits++;
+    ToolWindowManagerArea *area = m_areaPool.takeLast();
+    area->setParent(owner);
+    m_areas << area;
+    markLayoutDirty(area);
+    return area;
+  }
+
+  m_poolStatistics.areaMisses++;
   ToolWindowManagerArea *area = new ToolWindowManagerArea(this, owner);
+  area->m_poolable = true;
   connect(area, SIGNAL(tabCloseRequested(int)), this, SLOT(tabCloseRequested(int)));
   return area;
 }
 
 void ToolWindowManager::releaseToolWindow(QWidget *toolWindow)
 {
-  ToolWindowManagerArea *previousTabWidget = findClosestParent<ToolWindowManagerArea *>(toolWindow);
+  ToolWindowRecord *record = toolWindowRecord(toolWindow);
+  ToolWindowManagerArea *previousTabWidget = record ? record->area : NULL;
+  if(record)
+    record->area = NULL;
   if(!previousTabWidget)
   {
     qWarning("cannot find tab widget for tool window");
     return;
   }
-  previousTabWidget->removeTab(previousTabWidget->indexOf(toolWindow));
+  previousTabWidget->removeToolWindow(toolWindow);
   toolWindow->hide();
   // toolWindow->setParent(0);
 }
 
-void ToolWindowManager::simplifyLayout()
+void ToolWindowManager::touchArea(ToolWindowManagerArea *area)
 {
-  foreach(ToolWindowManagerArea *area, m_areas)
-  {
-    if(area->parentWidget() == 0)
-    {
-      if(area->count() == 0)
-      {
-        if(area == m_lastUsedArea)
-        {
-          m_lastUsedArea = 0;
-        }
-        // QTimer::singleShot(1000, area, SLOT(deleteLater()));
-        area->deleteLater();
-      }
-      continue;
-    }
-    QSplitter *splitter = qobject_cast<QSplitter *>(area->parentWidget());
-    QSplitter *validSplitter = 0;      // least top level splitter that should remain
-    QSplitter *invalidSplitter = 0;    // most top level splitter that should be deleted
-    while(splitter)
-    {
-      if(splitter->count() > 1)
-      {
-        validSplitter = splitter;
-        break;
-      }
-      else
-      {
-        invalidSplitter = splitter;
-        splitter = qobject_cast<QSplitter *>(splitter->parentWidget());
-      }
-    }
-    if(!validSplitter)
-    {
-      ToolWindowManagerWrapper *wrapper = findClosestParent<ToolWindowManagerWrapper *>(area);
-      if(!wrapper)
-      {
-        qWarning("can't find wrapper");
-        return;
-      }
-      if(area->count() == 0 && wrapper->isWindow())
-      {
-        wrapper->hide();
-        // can't deleteLater immediately (strange MacOS bug)
-        // QTimer::singleShot(1000, wrapper, SLOT(deleteLater()));
-        wrapper->deleteLater();
-      }
-      else if(area->parent() != wrapper)
-      {
-        wrapper->layout()->addWidget(area);
-      }
-    }
-    else
-    {
-      if(area->count() > 0)
-      {
-        if(validSplitter && area->parent() != validSplitter)
-        {
-          int index = validSplitter->indexOf(invalidSplitter);
-          validSplitter->insertWidget(index, area);
-        }
-      }
-    }
-    if(invalidSplitter)
-    {
-      invalidSplitter->hide();
-      invalidSplitter->setParent(0);
-      // QTimer::singleShot(1000, invalidSplitter, SLOT(deleteLater()));
-      invalidSplitter->deleteLater();
-    }
-    if(area->count() == 0)
-    {
-      area->hide();
-      area->setParent(0);
-      if(area == m_lastUsedArea)
-      {
-        m_lastUsedArea = 0;
-      }
-      // QTimer::singleShot(1000, area, SLOT(deleteLater()));
-      area->deleteLater();
-    }
-    // search up the stack looking for splitters that have only one child which is a splitter
-    splitter = qobject_cast<QSplitter *>(area->parentWidget());
-    QSplitter *parentSplitter = splitter ? qobject_cast<QSplitter *>(splitter->parentWidget()) : NULL;
-    while(splitter && parentSplitter)
-    {
-      // this splitter has only one child, and its direct parent is a splitter. Move our child
-      // widget
-      // into the parent and delete.
-      if(splitter->count() == 1)
-      {
-        int idx = parentSplitter->indexOf(splitter);
-        if(idx == -1)
-        {
-          qCritical() << "Couldn't find splitter in parent widget";
-          break;
-        }
-
-        QWidget *child = splitter->widget(0);
+  if(lastUsedArea() == area)
+    return;
 
-        parentSplitter->insertWidget(idx, child);
-        child->show();
+  m_areaUseOrder.removeOne(area);
+  m_areaUseOrder.prepend(area);
+}
 
-        splitter->setParent(NULL);
-        splitter->hide();
-        splitter->deleteLater();
-      }
+void ToolWindowManager::forgetArea(ToolWindowManagerArea *area)
+{
+  m_areaUseOrder.removeOne(area);
+}
 
-      // move up the stack
-      splitter = parentSplitter;
-      parentSplitter = qobject_cast<QSplitter *>(splitter->parentWidget());
-    }
-  }
+void ToolWindowManager::setPoolCapacity(int capacity)
+{
+  m_poolCapacity = qMax(0, capacity);
+  while(m_areaPool.count() > m_poolCapacity)
+    delete m_areaPool.takeLast();
+  while(m_splitterPool.count() > m_poolCapacity)
+    delete m_splitterPool.takeLast();
 }
 
-void ToolWindowManager::startDrag(const QList<QWidget *> &toolWindows,
-                                  ToolWindowManagerWrapper *wrapper)
+void ToolWindowManager::releaseArea(ToolWindowManagerArea *area)
 {
-  if(dragInProgress())
+  forgetArea(area);
+  area->releaseHiddenToolWindows();
+  // areas from a reimplemented createArea() may not be what the default one would hand out
+  if(!area->m_poolable || m_areaPool.count() >= m_poolCapacity)
   {
-    qWarning("ToolWindowManager::execDrag: drag is already in progress");
+    // QTimer::singleShot(1000, area, SLOT(deleteLater()));
+    area->deleteLater();
     return;
   }
-  foreach(QWidget *toolWindow, toolWindows)
+
+  m_poolStatistics.areasRecycled++;
+  m_areas.removeOne(area);
+  if(area->m_layoutDirty)
   {
-    if(toolWindowProperties(toolWindow) & DisallowUserDocking)
-    {
-      return;
-    }
+    area->m_layoutDirty = false;
+    m_dirtyAreas.removeOne(area);
   }
-  if(toolWindows.isEmpty())
+  area->recycle();
+  m_areaPool << area;
+}
+
+void ToolWindowManager::releaseSplitter(QSplitter *splitter)
+{
+  ToolWindowManagerSplitter *pooled = qobject_cast<ToolWindowManagerSplitter *>(splitter);
+  if(!pooled || !pooled->m_poolable || splitter->count() > 0 ||
+     m_splitterPool.count() >= m_poolCapacity)
   {
+    // QTimer::singleShot(1000, splitter, SLOT(deleteLater()));
+    splitter->deleteLater();
     return;
   }
 
-  m_draggedWrapper = wrapper;
-  m_draggedToolWindows = toolWindows;
-  qApp->installEventFilter(this);
+  m_poolStatistics.splittersRecycled++;
+  pooled->recycle();
+  setSplitterOrientation(splitter, Qt::Horizontal);
+  m_splitterPool << splitter;
 }
 
-QVariantMap ToolWindowManager::saveSplitterState(QSplitter *splitter)
+void ToolWindowManager::setSplitterOrientation(QSplitter *splitter, Qt::Orientation orientation)
 {
-  QVariantMap result;
-  result[QStringLiteral("state")] = splitter->saveState().toBase64();
+  splitter->setOrientation(orientation);
+
+  // once a size policy has been set QSplitter stops transposing it with the orientation, and a
+  // pooled splitter may have had one set, so set the policy a new splitter would have
+  ToolWindowManagerSplitter *ours = qobject_cast<ToolWindowManagerSplitter *>(splitter);
+  if(!ours || !ours->m_poolable)
+    return;
+
+  QSizePolicy policy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+  if(orientation == Qt::Vertical)
+    policy.transpose();
+  splitter->setSizePolicy(policy);
+}
+
+void ToolWindowManager::endRemovalBatch()
+{
+  if(--m_removalBatchDepth > 0)
+    return;
+
+  QList<QPointer<ToolWindowManagerSplitter>> splitters = m_pendingSplitters;
+  m_pendingSplitters.clear();
+  foreach(const QPointer<ToolWindowManagerSplitter> &splitter, splitters)
+  {
+    if(splitter)
+      splitter->applyPendingSizes();
+  }
+}
+
+QList<int> ToolWindowManager::splitterSizes(QSplitter *splitter)
+{
+  if(ToolWindowManagerSplitter *ours = qobject_cast<ToolWindowManagerSplitter *>(splitter))
+    ours->applyPendingSizes();
+  return splitter->sizes();
+}
+
+void ToolWindowManager::setSplitterSizes(QSplitter *splitter, const QList<int> &sizes)
+{
+  // otherwise the end of the batch would put back the sizes worked out for an earlier removal
+  if(ToolWindowManagerSplitter *ours = qobject_cast<ToolWindowManagerSplitter *>(splitter))
+    ours->discardPendingSizes();
+  splitter->setSizes(sizes);
+}
+
+void ToolWindowManager::markLayoutDirty(ToolWindowManagerArea *area)
+{
+  if(area->m_layoutDirty)
+    return;
+
+  area->m_layoutDirty = true;
+  m_dirtyAreas << area;
+}
+
+void ToolWindowManager::simplifyLayout()
+{
+  // simplifying an area can leave the splitters above it with a single child. Those are simplified
+  // from one of the areas left in them, which walks up through the splitter and its ancestors.
+  QList<QSplitter *> dirtySplitters;
+  // sizes are given out once per splitter for everything taken out of it
+  beginRemovalBatch();
+  while(!m_dirtyAreas.isEmpty() || !dirtySplitters.isEmpty())
+  {
+    ToolWindowManagerArea *area = NULL;
+    if(!m_dirtyAreas.isEmpty())
+    {
+      area = m_dirtyAreas.takeFirst();
+      area->m_layoutDirty = false;
+    }
+    else
+    {
+      QSplitter *splitter = dirtySplitters.takeFirst();
+      if(splitter->parentWidget() == 0)
+        continue;
+
+      QWidget *child = splitter;
+      while(qobject_cast<QSplitter *>(child))
+      {
+        splitter = static_cast<QSplitter *>(child);
+        child = splitter->count() > 0 ? splitter->widget(0) : NULL;
+      }
+      area = qobject_cast<ToolWindowManagerArea *>(child);
+      if(!area)
+        continue;
+    }
+
+    if(!simplifyArea(area, dirtySplitters))
+      break;
+  }
+  endRemovalBatch();
+}
+
+bool ToolWindowManager::simplifyArea(ToolWindowManagerArea *area,
+                                     QList<QSplitter *> &dirtySplitters)
+{
+  if(area->parentWidget() == 0)
+  {
+    if(area->count() == 0)
+    {
+      releaseArea(area);
+    }
+    return true;
+  }
+  QSplitter *splitter = qobject_cast<QSplitter *>(area->parentWidget());
+  QSplitter *validSplitter = 0;      // least top level splitter that should remain
+  QSplitter *invalidSplitter = 0;    // most top level splitter that should be deleted
+  while(splitter)
+  {
+    if(splitter->count() > 1)
+    {
+      validSplitter = splitter;
+      break;
+    }
+    else
+    {
+      invalidSplitter = splitter;
+      splitter = qobject_cast<QSplitter *>(splitter->parentWidget());
+    }
+  }
+  if(!validSplitter)
+  {
+    ToolWindowManagerWrapper *wrapper = area->wrapper();
+    if(!wrapper)
+    {
+      qWarning("can't find wrapper");
+      return false;
+    }
+    if(area->count() == 0 && wrapper->isWindow())
+    {
+      wrapper->hide();
+      // can't deleteLater immediately (strange MacOS bug)
+      // QTimer::singleShot(1000, wrapper, SLOT(deleteLater()));
+      wrapper->deleteLater();
+    }
+    else if(area->parent() != wrapper)
+    {
+      wrapper->layout()->addWidget(area);
+    }
+  }
+  else
+  {
+    if(area->count() > 0)
+    {
+      if(validSplitter && area->parent() != validSplitter)
+      {
+        int index = validSplitter->indexOf(invalidSplitter);
+        validSplitter->insertWidget(index, area);
+      }
+    }
+  }
+  if(invalidSplitter)
+  {
+    // the splitter that held it may be left with a single child
+    if(validSplitter)
+      dirtySplitters << validSplitter;
+    // taking it out of the layout hides it, without hiding it explicitly so it's shown again if
+    // it's reused from the pool
+    invalidSplitter->setParent(0);
+    releaseSplitter(invalidSplitter);
+  }
+  if(area->count() == 0)
+  {
+    if(QSplitter *oldSplitter = qobject_cast<QSplitter *>(area->parentWidget()))
+      dirtySplitters << oldSplitter;
+    area->setParent(0);
+    releaseArea(area);
+  }
+  // search up the stack looking for splitters that have only one child which is a splitter
+  splitter = qobject_cast<QSplitter *>(area->parentWidget());
+  QSplitter *parentSplitter = splitter ? qobject_cast<QSplitter *>(splitter->parentWidget()) : NULL;
+  while(splitter && parentSplitter)
+  {
+    // this splitter has only one child, and its direct parent is a splitter. Move our child
+    // widget
+    // into the parent and delete.
+    if(splitter->count() == 1)
+    {
+      int idx = parentSplitter->indexOf(splitter);
+      if(idx == -1)
+      {
+        qCritical() << "Couldn't find splitter in parent widget";
+        break;
+      }
+
+      QWidget *child = splitter->widget(0);
+
+      parentSplitter->insertWidget(idx, child);
+      child->show();
+
+      splitter->setParent(NULL);
+      releaseSplitter(splitter);
+    }
+
+    // move up the stack
+    splitter = parentSplitter;
+    parentSplitter = qobject_cast<QSplitter *>(splitter->parentWidget());
+  }
+  return true;
+}
+
+void ToolWindowManager::startDrag(const QList<QWidget *> &toolWindows,
+                                  ToolWindowManagerWrapper *wrapper)
+{
+  if(dragInProgress())
+  {
+    qWarning("ToolWindowManager::execDrag: drag is already in progress");
+    return;
+  }
+  foreach(QWidget *toolWindow, toolWindows)
+  {
+    if(toolWindowProperties(toolWindow) & DisallowUserDocking)
+    {
+      return;
+    }
+  }
+  if(toolWindows.isEmpty())
+  {
+    return;
+  }
+
+  m_draggedWrapper = wrapper;
+  m_draggedToolWindows = toolWindows;
+
+  // run at most one drag update per refresh of the screen
+  qreal refreshRate = 60.0;
+  if(QScreen *screen = QGuiApplication::primaryScreen())
+    refreshRate = qMax(screen->refreshRate(), qreal(1.0));
+  m_dragUpdateTimer->setInterval(qMax(1, qRound(1000.0 / refreshRate)));
+  m_dragUpdatePending = false;
+  m_dragUpdatesCoalesced = 0;
+
+  // the tear-off preview doesn't change during the drag, so its size is only calculated once
+  bool allowFloat = m_allowFloatingWindow;
+  QRect floatRect;
+  foreach(QWidget *toolWindow, toolWindows)
+  {
+    allowFloat &= !(toolWindowProperties(toolWindow) & DisallowFloatWindow);
+    if(toolWindow->isVisible())
+      floatRect = floatRect.united(toolWindow->rect());
+  }
+  m_dragFloatPreviewSize = (wrapper || !allowFloat) ? QSize() : floatRect.size();
+  m_dragFeedback = DragFeedback();
+  m_dragStatistics = DragStatistics();
+
+  buildDragHitCache();
+  grabDragInput();
+
+  m_dragOverlayBounds = QRect();
+  foreach(ToolWindowManagerWrapper *w, m_wrappers)
+  {
+    if(w->isVisible())
+      m_dragOverlayBounds |= QRect(w->mapToGlobal(QPoint(0, 0)), w->size());
+  }
+}
+
+void ToolWindowManager::grabDragInput()
+{
+  foreach(QWindow *window, QGuiApplication::topLevelWindows())
+  {
+    window->installEventFilter(this);
+    m_dragInputWindows << window;
+  }
+}
+
+void ToolWindowManager::releaseDragInput()
+{
+  foreach(const QPointer<QWindow> &window, m_dragInputWindows)
+  {
+    if(window)
+      window->removeEventFilter(this);
+  }
+  m_dragInputWindows.clear();
+}
+
+void ToolWindowManager::buildDragHitCache()
+{
+  m_dragHitAreas.clear();
+  m_dragHitWrappers.clear();
+  m_dragHitGrid.clear();
+  m_dragSplitterSegments.clear();
+
+  foreach(ToolWindowManagerArea *area, m_areas)
+  {
+    // don't allow dragging a whole wrapper into a subset of itself
+    if(m_draggedWrapper && area->window() == m_draggedWrapper->window())
+    {
+      continue;
+    }
+    if(!area->isVisible())
+    {
+      continue;
+    }
+
+    QRect r(area->mapToGlobal(QPoint(0, 0)), area->size());
+    m_dragStatistics.globalMappings++;
+    int index = m_dragHitAreas.count();
+    DragHitArea hit = {r, area, area->wrapper()};
+    m_dragHitAreas.push_back(hit);
+
+    for(int x = dragHitCellIndex(r.left()); x <= dragHitCellIndex(r.right()); x++)
+    {
+      for(int y = dragHitCellIndex(r.top()); y <= dragHitCellIndex(r.bottom()); y++)
+      {
+        m_dragHitGrid[dragHitCellKey(x, y)].push_back(index);
+      }
+    }
+  }
+
+  // front to back, so the first wrapper found under the cursor is the one that's visible there
+  foreach(ToolWindowManagerWrapper *wrapper, m_wrapperZOrder)
+  {
+    // don't allow dragging a whole wrapper into a subset of itself
+    if(wrapper == m_draggedWrapper || !wrapper->isVisible())
+    {
+      continue;
+    }
+    m_dragHitWrappers.push_back(
+        qMakePair(QRect(wrapper->mapToGlobal(QPoint(0, 0)), wrapper->size()), wrapper));
+    m_dragStatistics.globalMappings++;
+  }
+
+  m_dragHitGeneration++;
+  m_dragHitCacheValid = true;
+}
+
+ToolWindowManagerArea *ToolWindowManager::dragHitArea(ToolWindowManagerWrapper *wrapper,
+                                                      const QPoint &pos)
+{
+  if(!m_dragHitCacheValid)
+    buildDragHitCache();
+
+  m_dragStatistics.hitTests++;
+
+  QHash<quint64, QVector<int>>::const_iterator cell =
+      m_dragHitGrid.constFind(dragHitCellKey(dragHitCellIndex(pos.x()), dragHitCellIndex(pos.y())));
+  if(cell == m_dragHitGrid.constEnd())
+    return NULL;
+
+  // areas in other wrappers are either behind this one or not under the cursor
+  for(int index : *cell)
+  {
+    const DragHitArea &hit = m_dragHitAreas[index];
+    if(hit.wrapper == wrapper && hit.rect.contains(pos))
+      return hit.area;
+  }
+
+  return NULL;
+}
+
+ToolWindowManagerWrapper *ToolWindowManager::dragHitWrapper(const QPoint &pos)
+{
+  if(!m_dragHitCacheValid)
+    buildDragHitCache();
+
+  m_dragStatistics.hitTests++;
+
+  for(const QPair<QRect, ToolWindowManagerWrapper *> &hit : m_dragHitWrappers)
+  {
+    if(hit.first.contains(pos))
+      return hit.second;
+  }
+
+  return NULL;
+}
+
+const ToolWindowManager::DragSplitterSegment *ToolWindowManager::dragSplitterSegmentAt(
+    QSplitter *splitter, const QPoint &pos)
+{
+  const bool horizontal = splitter->orientation() == Qt::Horizontal;
+
+  QHash<QSplitter *, QVector<DragSplitterSegment>>::iterator it =
+      m_dragSplitterSegments.find(splitter);
+  if(it == m_dragSplitterSegments.end())
+  {
+    it = m_dragSplitterSegments.insert(splitter, QVector<DragSplitterSegment>());
+    QVector<DragSplitterSegment> &segments = *it;
+
+    QWidget *previous = NULL;
+    for(int i = 0; i < splitter->count(); i++)
+    {
+      QWidget *widget = splitter->widget(i);
+      if(widget->isHidden())
+        continue;
+
+      // the handle at index i sits between widget i and the visible widget before it
+      if(previous)
+      {
+        QSplitterHandle *handle = splitter->handle(i);
+        DragSplitterSegment segment = {QRect(handle->mapToGlobal(QPoint(0, 0)), handle->size()),
+                                       previous, widget};
+        segments.push_back(segment);
+        m_dragStatistics.globalMappings++;
+      }
+
+      DragSplitterSegment segment = {QRect(widget->mapToGlobal(QPoint(0, 0)), widget->size()),
+                                     widget, NULL};
+      segments.push_back(segment);
+      m_dragStatistics.globalMappings++;
+      previous = widget;
+    }
+
+    // right-to-left layouts run horizontal splitters backwards
+    std::sort(segments.begin(), segments.end(),
+              [horizontal](const DragSplitterSegment &a, const DragSplitterSegment &b) {
+                return horizontal ? a.rect.left() < b.rect.left() : a.rect.top() < b.rect.top();
+              });
+  }
+
+  const QVector<DragSplitterSegment> &segments = *it;
+  const int coord = horizontal ? pos.x() : pos.y();
+
+  m_dragStatistics.hitTests++;
+
+  // find the last segment starting at or before the cursor
+  QVector<DragSplitterSegment>::const_iterator segment = std::upper_bound(
+      segments.constBegin(), segments.constEnd(), coord,
+      [horizontal](int c, const DragSplitterSegment &s) {
+        return c < (horizontal ? s.rect.left() : s.rect.top());
+      });
+
+  if(segment == segments.constBegin())
+    return NULL;
+
+  --segment;
+  return segment->rect.contains(pos) ? &*segment : NULL;
+}
+
+QVariantMap ToolWindowManager::saveSplitterState(QSplitter *splitter)
+{
+  QVariantMap result;
+  result[QStringLiteral("state")] = splitter->saveState().toBase64();
   result[QStringLiteral("type")] = QStringLiteral("splitter");
   QVariantList items;
   for(int i = 0; i < splitter->count(); i++)
@@ -878,238 +1485,212 @@ QSplitter *ToolWindowManager::restoreSplitterState(const QVariantMap &savedData)
   return splitter;
 }
 
+void ToolWindowManager::raiseWrapper(ToolWindowManagerWrapper *wrapper)
+{
+  // the main wrapper stays behind all floating wrappers
+  if(!wrapper->floating() || m_wrapperZOrder.value(0) == wrapper)
+    return;
+
+  m_wrapperZOrder.removeOne(wrapper);
+  m_wrapperZOrder.prepend(wrapper);
+  invalidateDragHitCache();
+}
+
 void ToolWindowManager::updateDragPosition()
 {
   if(!dragInProgress())
   {
     return;
   }
-  if(!(qApp->mouseButtons() & Qt::LeftButton))
+
+  // an update already ran this frame, defer this one until the frame is over. A release is never
+  // deferred, the drop has to happen where the button was let go.
+  if(m_dragUpdateTimer->isActive() && (qApp->mouseButtons() & Qt::LeftButton))
   {
-    finishDrag();
+    if(m_dragUpdatePending)
+      m_dragUpdatesCoalesced++;
+    m_dragUpdatePending = true;
     return;
   }
 
-  QPoint pos = QCursor::pos();
-  m_hoverArea = NULL;
-  ToolWindowManagerWrapper *hoverWrapper = NULL;
+  m_dragUpdateTimer->start();
+  processDragPosition();
+}
 
-  foreach(ToolWindowManagerArea *area, m_areas)
+void ToolWindowManager::dragUpdateTimeout()
+{
+  if(!m_dragUpdatePending)
+    return;
+
+  m_dragUpdatePending = false;
+  m_dragUpdateTimer->start();
+  processDragPosition();
+}
+
+void ToolWindowManager::processDragPosition()
+{
+  if(!dragInProgress())
   {
-    // don't allow dragging a whole wrapper into a subset of itself
-    if(m_draggedWrapper && area->window() == m_draggedWrapper->window())
-    {
-      continue;
-    }
-    if(area->rect().contains(area->mapFromGlobal(pos)))
-    {
-      m_hoverArea = area;
-      break;
-    }
+    return;
   }
-
-  if(m_hoverArea == NULL)
+  if(!(qApp->mouseButtons() & Qt::LeftButton))
   {
-    foreach(ToolWindowManagerWrapper *wrapper, m_wrappers)
-    {
-      // don't allow dragging a whole wrapper into a subset of itself
-      if(wrapper == m_draggedWrapper)
-      {
-        continue;
-      }
-      if(wrapper->rect().contains(wrapper->mapFromGlobal(pos)))
-      {
-        hoverWrapper = wrapper;
-        break;
-      }
-    }
-
-    // if we found a wrapper and it's not empty, then we fill into a gap between two areas in a
-    // splitter. Search down the hierarchy until we find a splitter whose handle intersects the
-    // cursor and pick an area to map to.
-    if(hoverWrapper)
-    {
-      QLayout *layout = hoverWrapper->layout();
-      QLayoutItem *layoutitem = layout ? layout->itemAt(0) : NULL;
-      QWidget *layoutwidget = layoutitem ? layoutitem->widget() : NULL;
-      QSplitter *splitter = qobject_cast<QSplitter *>(layoutwidget);
-
-      while(splitter)
-      {
-        QSplitter *previous = splitter;
-
-        for(int h = 1; h < splitter->count(); h++)
-        {
-          QSplitterHandle *handle = splitter->handle(h);
-
-          if(handle->rect().contains(handle->mapFromGlobal(pos)))
-          {
-            QWidget *a = splitter->widget(h);
-            QWidget *b = splitter->widget(h + 1);
-
-            // try the first widget, if it's an area stop
-            m_hoverArea = qobject_cast<ToolWindowManagerArea *>(a);
-            if(m_hoverArea)
-              break;
-
-            // then the second widget
-            m_hoverArea = qobject_cast<ToolWindowManagerArea *>(b);
-            if(m_hoverArea)
-              break;
-
-            // neither widget is an area - let's search for a splitter to recurse to
-            splitter = qobject_cast<QSplitter *>(a);
-            if(splitter)
-              break;
-
-            splitter = qobject_cast<QSplitter *>(b);
-            if(splitter)
-              break;
-
-            // neither side is an area or a splitter - should be impossible, but stop recursing
-            // and treat this like a floating window
-            qWarning("Couldn't find splitter or area at terminal side of splitter");
-            splitter = NULL;
-            hoverWrapper = NULL;
-            break;
-          }
-        }
-
-        // if we still have a splitter, and didn't find an area, find which widget contains the
-        // cursor and recurse to that splitter
-        if(previous == splitter && !m_hoverArea)
-        {
-          for(int w = 0; w < splitter->count(); w++)
-          {
-            QWidget *widget = splitter->widget(w);
-
-            if(widget->rect().contains(widget->mapFromGlobal(pos)))
-            {
-              splitter = qobject_cast<QSplitter *>(widget);
-              if(splitter)
-                break;
-
-              // if this isn't a splitter, and it's not an area (since that would have been found
-              // before any of this started) then bail out
-              qWarning("cursor inside unknown child widget that isn't a splitter or area");
-              splitter = NULL;
-              hoverWrapper = NULL;
-              break;
-            }
-          }
-        }
-
-        // we found an area to use! stop now
-        if(m_hoverArea)
-          break;
-
-        // if we still haven't found anything, bail out
-        if(previous == splitter)
-        {
-          qWarning("Couldn't find cursor inside any child of wrapper");
-          splitter = NULL;
-          hoverWrapper = NULL;
-          break;
-        }
-      }
-    }
+    finishDrag();
+    return;
   }
 
-  if(m_hoverArea || hoverWrapper)
+  if(!m_dragStatisticsEnabled)
   {
-    ToolWindowManagerWrapper *wrapper = hoverWrapper;
-    if(m_hoverArea)
-      wrapper = findClosestParent<ToolWindowManagerWrapper *>(m_hoverArea);
-    QRect wrapperGeometry;
-    wrapperGeometry.setSize(wrapper->rect().size());
-    wrapperGeometry.moveTo(wrapper->mapToGlobal(QPoint(0, 0)));
+    updateDragFeedback(QCursor::pos());
+    return;
+  }
 
-    const int margin = m_dropHotspotMargin;
+  QElapsedTimer timer;
+  timer.start();
 
-    const int size = m_dropHotspotDimension;
-    const int hsize = size / 2;
+  updateDragFeedback(QCursor::pos());
 
-    if(m_hoverArea)
-    {
-      QRect areaClientRect;
+  qint64 elapsed = timer.nsecsElapsed();
+
+  // find the first bucket whose upper bound of 2^i microseconds is above the elapsed time
+  int bucket = 0;
+  while(bucket < DragStatistics::LatencyBuckets - 1 && (qint64(1) << bucket) * 1000 <= elapsed)
+    bucket++;
 
-      // calculate the rect of the area
-      areaClientRect.setTopLeft(m_hoverArea->mapToGlobal(QPoint(0, 0)));
-      areaClientRect.setSize(m_hoverArea->rect().size());
+  m_dragStatistics.updates++;
+  m_dragStatistics.updateLatency[bucket]++;
+  m_dragStatistics.totalUpdateTime += elapsed;
+  m_dragStatistics.maxUpdateTime = qMax(m_dragStatistics.maxUpdateTime, elapsed);
+}
 
-      // subtract the rect for the tab bar.
-      areaClientRect.adjust(0, m_hoverArea->tabBar()->rect().height(), 0, 0);
+void ToolWindowManager::updateDragFeedback(const QPoint &pos)
+{
+  // hit-test the wrappers front to back, then only the areas inside the front-most wrapper under
+  // the cursor. Areas in windows occluded by it are never tested.
+  ToolWindowManagerWrapper *hoverWrapper = dragHitWrapper(pos);
+  m_hoverArea = hoverWrapper ? dragHitArea(hoverWrapper, pos) : NULL;
 
-      QPoint c = areaClientRect.center();
+  if(m_hoverArea)
+  {
+    hoverWrapper = NULL;
+  }
+  else
+  {
+    // if we found a wrapper and it's not empty, then we fill into a gap between two areas in a
+    // splitter. Search down the hierarchy until we find a splitter whose handle intersects the
+    // cursor and pick an area to map to.
+    if(hoverWrapper)
+    {
+      QSplitter *splitter = qobject_cast<QSplitter *>(hoverWrapper->rootWidget());
 
-      m_dropHotspots[AddTo]->move(c + QPoint(-hsize, -hsize));
-      m_dropHotspots[AddTo]->show();
+      while(splitter)
+      {
+        const DragSplitterSegment *segment = dragSplitterSegmentAt(splitter, pos);
 
-      m_dropHotspots[TopOf]->move(c + QPoint(-hsize, -hsize - margin - size));
-      m_dropHotspots[TopOf]->show();
+        // if we still haven't found anything, bail out
+        if(!segment)
+        {
+          qWarning("Couldn't find cursor inside any child of wrapper");
+          hoverWrapper = NULL;
+          break;
+        }
 
-      m_dropHotspots[LeftOf]->move(c + QPoint(-hsize - margin - size, -hsize));
-      m_dropHotspots[LeftOf]->show();
+        if(segment->after)
+        {
+          QWidget *a = segment->before;
+          QWidget *b = segment->after;
 
-      m_dropHotspots[RightOf]->move(c + QPoint(hsize + margin, -hsize));
-      m_dropHotspots[RightOf]->show();
+          // try the first widget, if it's an area stop
+          m_hoverArea = qobject_cast<ToolWindowManagerArea *>(a);
+          if(m_hoverArea)
+            break;
 
-      m_dropHotspots[BottomOf]->move(c + QPoint(-hsize, hsize + margin));
-      m_dropHotspots[BottomOf]->show();
+          // then the second widget
+          m_hoverArea = qobject_cast<ToolWindowManagerArea *>(b);
+          if(m_hoverArea)
+            break;
 
-      c = wrapperGeometry.center();
+          // neither widget is an area - let's search for a splitter to recurse to
+          splitter = qobject_cast<QSplitter *>(a);
+          if(splitter)
+            continue;
 
-      m_dropHotspots[TopWindowSide]->move(QPoint(c.x() - hsize, wrapperGeometry.y() + margin * 2));
-      m_dropHotspots[TopWindowSide]->show();
+          splitter = qobject_cast<QSplitter *>(b);
+          if(splitter)
+            continue;
 
-      m_dropHotspots[LeftWindowSide]->move(QPoint(wrapperGeometry.x() + margin * 2, c.y() - hsize));
-      m_dropHotspots[LeftWindowSide]->show();
+          // neither side is an area or a splitter - should be impossible, but stop recursing
+          // and treat this like a floating window
+          qWarning("Couldn't find splitter or area at terminal side of splitter");
+          hoverWrapper = NULL;
+          break;
+        }
 
-      m_dropHotspots[RightWindowSide]->move(
-          QPoint(wrapperGeometry.right() - size - margin * 2, c.y() - hsize));
-      m_dropHotspots[RightWindowSide]->show();
+        // the cursor is inside a child widget, recurse to that splitter
+        splitter = qobject_cast<QSplitter *>(segment->before);
+        if(splitter)
+          continue;
 
-      m_dropHotspots[BottomWindowSide]->move(
-          QPoint(c.x() - hsize, wrapperGeometry.bottom() - size - margin * 2));
-      m_dropHotspots[BottomWindowSide]->show();
+        // if this isn't a splitter, and it's not an area (since that would have been found
+        // before any of this started) then bail out
+        qWarning("cursor inside unknown child widget that isn't a splitter or area");
+        hoverWrapper = NULL;
+        break;
+      }
     }
-    else
-    {
-      m_dropHotspots[AddTo]->move(wrapperGeometry.center() + QPoint(-hsize, -hsize));
-      m_dropHotspots[AddTo]->show();
+  }
 
-      m_dropHotspots[TopOf]->hide();
-      m_dropHotspots[LeftOf]->hide();
-      m_dropHotspots[RightOf]->hide();
-      m_dropHotspots[BottomOf]->hide();
+  DragFeedback feedback;
+  feedback.area = m_hoverArea;
+  feedback.wrapper = hoverWrapper;
+  feedback.hitGeneration = m_dragHitGeneration;
 
-      m_dropHotspots[TopWindowSide]->hide();
-      m_dropHotspots[LeftWindowSide]->hide();
-      m_dropHotspots[RightWindowSide]->hide();
-      m_dropHotspots[BottomWindowSide]->hide();
-    }
+  // the hotspots only move when the cursor enters a different drop target, or when the drop
+  // targets themselves moved since they were laid out
+  if(feedback.area != m_dragFeedback.area || feedback.wrapper != m_dragFeedback.wrapper ||
+     feedback.hitGeneration != m_dragFeedback.hitGeneration)
+  {
+    layoutDragHotspots(hoverWrapper);
+  }
 
-    for(QWidget *hotspot : m_dropHotspots)
-      if(hotspot)
-        hotspot->show();
+  if(m_dragStatisticsEnabled)
+  {
+    QElapsedTimer timer;
+    timer.start();
+    feedback.hotspot = currentHotspot(pos);
+    m_dragStatistics.hotspotTime += timer.nsecsElapsed();
   }
   else
   {
-    for(QWidget *hotspot : m_dropHotspots)
-      if(hotspot)
-        hotspot->hide();
+    feedback.hotspot = currentHotspot(pos);
+  }
+
+  if(feedback.hotspot == AddTo && m_hoverArea && m_hoverTabRects.count() > 1)
+  {
+    for(int i = 0; i < m_hoverTabRects.count(); i++)
+    {
+      if(m_hoverTabRects[i].contains(pos))
+      {
+        feedback.tabIndex = i;
+        break;
+      }
+    }
   }
 
-  AreaReferenceType hotspot = currentHotspot();
+  // a tear-off preview follows the cursor, nothing else depends on the exact position
+  if(feedback.hotspot == NewFloatingArea && !m_dragFloatPreviewSize.isEmpty())
+    feedback.floatPos = pos;
+
+  if(feedback == m_dragFeedback)
+    return;
+
+  m_dragFeedback = feedback;
+
+  AreaReferenceType hotspot = feedback.hotspot;
   if((m_hoverArea || hoverWrapper) && (hotspot == AddTo || hotspot == LeftOf || hotspot == RightOf ||
                                        hotspot == TopOf || hotspot == BottomOf))
   {
-    QWidget *parent = m_hoverArea;
-    if(parent == NULL)
-      parent = hoverWrapper;
-
-    QRect g = parent->geometry();
-    g.moveTopLeft(parent->parentWidget()->mapToGlobal(g.topLeft()));
+    QRect g = m_hoverRect;
 
     if(hotspot == LeftOf)
       g.adjust(0, 0, -g.width() / 2, 0);
@@ -1122,17 +1703,13 @@ void ToolWindowManager::updateDragPosition()
 
     QRect tabGeom;
 
-    if(hotspot == AddTo && m_hoverArea && m_hoverArea->count() > 1)
+    if(hotspot == AddTo && m_hoverArea && m_hoverTabRects.count() > 1)
     {
-      QTabBar *tb = m_hoverArea->tabBar();
-      g.adjust(0, tb->rect().height(), 0, 0);
+      g.adjust(0, m_hoverTabBarRect.height(), 0, 0);
 
-      int idx = tb->tabAt(tb->mapFromGlobal(pos));
-
-      if(idx == -1)
+      if(feedback.tabIndex == -1)
       {
-        tabGeom = tb->tabRect(m_hoverArea->count() - 1);
-        tabGeom.moveTo(tb->mapToGlobal(QPoint(0, 0)) + tabGeom.topLeft());
+        tabGeom = m_hoverTabRects.last();
 
         // move the tab one to the right, to indicate the tab is being added after the last one.
         tabGeom.moveLeft(tabGeom.left() + tabGeom.width());
@@ -1143,25 +1720,17 @@ void ToolWindowManager::updateDragPosition()
       }
       else
       {
-        tabGeom = tb->tabRect(idx);
-        tabGeom.moveTo(tb->mapToGlobal(QPoint(0, 0)) + tabGeom.topLeft());
+        tabGeom = m_hoverTabRects[feedback.tabIndex];
       }
     }
 
-    m_previewOverlay->setGeometry(g);
-
-    m_previewTabOverlay->setGeometry(tabGeom);
+    m_previewRect = g;
+    m_previewTabRect = tabGeom;
   }
   else if((m_hoverArea || hoverWrapper) && (hotspot == LeftWindowSide || hotspot == RightWindowSide ||
                                             hotspot == TopWindowSide || hotspot == BottomWindowSide))
   {
-    ToolWindowManagerWrapper *wrapper = hoverWrapper;
-    if(m_hoverArea)
-      wrapper = findClosestParent<ToolWindowManagerWrapper *>(m_hoverArea);
-
-    QRect g;
-    g.moveTopLeft(wrapper->mapToGlobal(QPoint()));
-    g.setSize(wrapper->rect().size());
+    QRect g = m_hoverWrapperRect;
 
     if(hotspot == LeftWindowSide)
       g.adjust(0, 0, -(g.width() * 5) / 6, 0);
@@ -1172,41 +1741,254 @@ void ToolWindowManager::updateDragPosition()
     else if(hotspot == BottomWindowSide)
       g.adjust(0, (g.height() * 3) / 4, 0, 0);
 
-    m_previewOverlay->setGeometry(g);
-    m_previewTabOverlay->setGeometry(QRect());
+    m_previewRect = g;
+    m_previewTabRect = QRect();
   }
   else
   {
-    bool allowFloat = m_allowFloatingWindow;
-
-    for(QWidget *w : m_draggedToolWindows)
-      allowFloat &= !(toolWindowProperties(w) & DisallowFloatWindow);
-
     // no hotspot highlighted, draw geometry for a float window if previewing a tear-off, or draw
     // nothing if we're dragging a float window as it moves itself.
     // we also don't render any preview tear-off when floating windows are disallowed
-    if(m_draggedWrapper || !allowFloat)
+    if(m_dragFloatPreviewSize.isEmpty())
+      m_previewRect = QRect();
+    else
+      m_previewRect = QRect(feedback.floatPos, m_dragFloatPreviewSize);
+    m_previewTabRect = QRect();
+  }
+
+  updateDragOverlays();
+}
+
+void ToolWindowManager::layoutDragHotspots(ToolWindowManagerWrapper *hoverWrapper)
+{
+  m_hoverTabBarRect = QRect();
+  m_hoverTabRects.clear();
+
+  if(!m_hoverArea && !hoverWrapper)
+  {
+    m_hoverRect = m_hoverWrapperRect = QRect();
+    for(QRect &hotspot : m_hotspotRects)
+      hotspot = QRect();
+    return;
+  }
+
+  ToolWindowManagerWrapper *wrapper = hoverWrapper;
+  if(m_hoverArea)
+    wrapper = m_hoverArea->wrapper();
+  QRect wrapperGeometry;
+  wrapperGeometry.setSize(wrapper->rect().size());
+  wrapperGeometry.moveTo(wrapper->mapToGlobal(QPoint(0, 0)));
+  m_dragStatistics.globalMappings++;
+
+  m_hoverWrapperRect = wrapperGeometry;
+
+  const int margin = m_dropHotspotMargin;
+
+  const int size = m_dropHotspotDimension;
+  const int hsize = size / 2;
+  const QSize hotspotSize(size, size);
+
+  if(m_hoverArea)
+  {
+    QTabBar *tb = m_hoverArea->tabBar();
+    QPoint tabBarPos = tb->mapToGlobal(QPoint(0, 0));
+
+    m_hoverRect = QRect(m_hoverArea->mapToGlobal(QPoint(0, 0)), m_hoverArea->size());
+    m_hoverTabBarRect = QRect(tabBarPos, tb->size());
+    for(int i = 0; i < m_hoverArea->count(); i++)
+      m_hoverTabRects.push_back(tb->tabRect(i).translated(tabBarPos));
+    m_dragStatistics.globalMappings += 2;
+
+    // calculate the rect of the area, and subtract the rect for the tab bar.
+    QRect areaClientRect = m_hoverRect.adjusted(0, m_hoverTabBarRect.height(), 0, 0);
+
+    QPoint c = areaClientRect.center();
+
+    m_hotspotRects[AddTo] = QRect(c + QPoint(-hsize, -hsize), hotspotSize);
+    m_hotspotRects[TopOf] = QRect(c + QPoint(-hsize, -hsize - margin - size), hotspotSize);
+    m_hotspotRects[LeftOf] = QRect(c + QPoint(-hsize - margin - size, -hsize), hotspotSize);
+    m_hotspotRects[RightOf] = QRect(c + QPoint(hsize + margin, -hsize), hotspotSize);
+    m_hotspotRects[BottomOf] = QRect(c + QPoint(-hsize, hsize + margin), hotspotSize);
+
+    c = wrapperGeometry.center();
+
+    m_hotspotRects[TopWindowSide] =
+        QRect(QPoint(c.x() - hsize, wrapperGeometry.y() + margin * 2), hotspotSize);
+    m_hotspotRects[LeftWindowSide] =
+        QRect(QPoint(wrapperGeometry.x() + margin * 2, c.y() - hsize), hotspotSize);
+    m_hotspotRects[RightWindowSide] =
+        QRect(QPoint(wrapperGeometry.right() - size - margin * 2, c.y() - hsize), hotspotSize);
+    m_hotspotRects[BottomWindowSide] =
+        QRect(QPoint(c.x() - hsize, wrapperGeometry.bottom() - size - margin * 2), hotspotSize);
+  }
+  else
+  {
+    m_hoverRect = wrapperGeometry;
+
+    // only the AddTo hotspot is available when hovering over a wrapper
+    for(QRect &hotspot : m_hotspotRects)
+      hotspot = QRect();
+
+    m_hotspotRects[AddTo] = QRect(wrapperGeometry.center() + QPoint(-hsize, -hsize), hotspotSize);
+  }
+}
+
+bool ToolWindowManager::translucentOverlaysSupported() const
+{
+#ifdef TOOLWINDOWMANAGER_X11EXTRAS
+  if(QX11Info::isPlatformX11())
+    return QX11Info::isCompositingManagerRunning();
+#endif
+  // there's no way to ask an X11 server about compositing without QX11Info, so assume the worst.
+  // Other platforms always composite.
+  return QGuiApplication::platformName() != QStringLiteral("xcb");
+}
+
+void ToolWindowManager::createFallbackOverlays()
+{
+  if(m_previewOverlay)
+    return;
+
+  QPalette pal = palette();
+  pal.setColor(QPalette::Background, pal.color(QPalette::Highlight));
+
+  m_previewOverlay = new QWidget(NULL);
+  m_previewOverlay->setAutoFillBackground(true);
+  m_previewOverlay->setPalette(pal);
+  m_previewOverlay->setWindowFlags(Qt::Tool | Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint |
+                                   Qt::X11BypassWindowManagerHint);
+  m_previewOverlay->setWindowOpacity(0.3);
+  m_previewOverlay->setAttribute(Qt::WA_ShowWithoutActivating);
+  m_previewOverlay->setAttribute(Qt::WA_AlwaysStackOnTop);
+
+  m_previewTabOverlay = new QWidget(NULL);
+  m_previewTabOverlay->setAutoFillBackground(true);
+  m_previewTabOverlay->setPalette(pal);
+  m_previewTabOverlay->setWindowFlags(Qt::Tool | Qt::FramelessWindowHint |
+                                      Qt::WindowStaysOnTopHint | Qt::X11BypassWindowManagerHint);
+  m_previewTabOverlay->setWindowOpacity(0.3);
+  m_previewTabOverlay->setAttribute(Qt::WA_ShowWithoutActivating);
+  m_previewTabOverlay->setAttribute(Qt::WA_AlwaysStackOnTop);
+
+  for(AreaReferenceType type : {AddTo, TopOf, LeftOf, RightOf, BottomOf, TopWindowSide,
+                                LeftWindowSide, RightWindowSide, BottomWindowSide})
+  {
+    m_dropHotspots[type] = new QLabel(NULL);
+    m_dropHotspots[type]->setWindowFlags(Qt::Tool | Qt::FramelessWindowHint |
+                                         Qt::WindowStaysOnTopHint | Qt::X11BypassWindowManagerHint);
+    m_dropHotspots[type]->setAttribute(Qt::WA_ShowWithoutActivating);
+    m_dropHotspots[type]->setAttribute(Qt::WA_AlwaysStackOnTop);
+  }
+}
+
+void ToolWindowManager::updateFallbackOverlays()
+{
+  createFallbackOverlays();
+
+  // only windows whose rect changed are touched
+  auto apply = [](QWidget *w, const QRect &rect) {
+    if(rect.isEmpty())
     {
-      m_previewOverlay->setGeometry(QRect());
+      if(w->isVisible())
+        w->hide();
+      return;
     }
-    else
+    if(w->geometry() != rect)
+      w->setGeometry(rect);
+    if(!w->isVisible())
+    {
+      w->show();
+      w->raise();
+    }
+  };
+
+  apply(m_previewOverlay, m_previewRect);
+  apply(m_previewTabOverlay, m_previewTabRect);
+  for(int i = 0; i < NumReferenceTypes; i++)
+  {
+    if(!m_dropHotspots[i])
+      continue;
+    if(!m_hotspotRects[i].isEmpty() && !m_dropHotspots[i]->isVisible())
+      m_dropHotspots[i]->setPixmap(m_pixmaps[i]);
+    apply(m_dropHotspots[i], m_hotspotRects[i]);
+  }
+}
+
+void ToolWindowManager::updateDragOverlays()
+{
+  m_dragStatistics.overlayUpdates++;
+
+  if(!translucentOverlaysSupported())
+  {
+    updateFallbackOverlays();
+    return;
+  }
+
+  // hotspots are always inside a wrapper, previews aren't when tearing off a floating window
+  m_dragOverlayBounds = m_dragOverlayBounds.united(m_previewRect).united(m_previewTabRect);
+
+  foreach(QScreen *screen, QGuiApplication::screens())
+  {
+    ToolWindowManagerOverlay *overlay = m_overlays.value(screen);
+    QRect bounds = m_dragOverlayBounds.intersected(screen->geometry());
+    if(bounds.isEmpty())
+    {
+      if(overlay && overlay->isVisible())
+        overlay->hide();
+      continue;
+    }
+
+    if(!overlay)
+    {
+      overlay = new ToolWindowManagerOverlay(this);
+      m_overlays[screen] = overlay;
+    }
+    overlay->setBounds(bounds);
+
+    overlay->setDragState(m_previewRect, m_previewTabRect, m_hotspotRects);
+
+    if(overlay->hasContent())
     {
-      QRect r;
-      for(QWidget *w : m_draggedToolWindows)
+      if(!overlay->isVisible())
       {
-        if(w->isVisible())
-          r = r.united(w->rect());
+        overlay->show();
+        overlay->raise();
       }
-      m_previewOverlay->setGeometry(pos.x(), pos.y(), r.width(), r.height());
     }
-    m_previewTabOverlay->setGeometry(QRect());
+    else if(overlay->isVisible())
+    {
+      overlay->hide();
+    }
+  }
+}
+
+void ToolWindowManager::hideDragOverlays()
+{
+  m_previewRect = m_previewTabRect = QRect();
+  for(QRect &hotspot : m_hotspotRects)
+    hotspot = QRect();
+
+  for(ToolWindowManagerOverlay *overlay : m_overlays)
+  {
+    overlay->setDragState(m_previewRect, m_previewTabRect, m_hotspotRects);
+    overlay->hide();
+  }
+
+  if(m_previewOverlay)
+  {
+    m_previewOverlay->hide();
+    m_previewTabOverlay->hide();
+    for(QWidget *hotspot : m_dropHotspots)
+    {
+      if(hotspot)
+        hotspot->hide();
+    }
   }
+}
 
-  m_previewOverlay->show();
-  m_previewTabOverlay->show();
-  for(QWidget *h : m_dropHotspots)
-    if(h && h->isVisible())
-      h->raise();
+void ToolWindowManager::screenRemoved(QScreen *screen)
+{
+  delete m_overlays.take(screen);
 }
 
 void ToolWindowManager::abortDrag()
@@ -1214,14 +1996,15 @@ void ToolWindowManager::abortDrag()
   if(!dragInProgress())
     return;
 
-  m_previewOverlay->hide();
-  m_previewTabOverlay->hide();
-  for(QWidget *hotspot : m_dropHotspots)
-    if(hotspot)
-      hotspot->hide();
+  hideDragOverlays();
   m_draggedToolWindows.clear();
   m_draggedWrapper = NULL;
-  qApp->removeEventFilter(this);
+  m_dragHitCacheValid = false;
+  m_dragUpdateTimer->stop();
+  m_dragUpdatePending = false;
+  releaseDragInput();
+
+  emitDragStatistics(true);
 }
 
 void ToolWindowManager::finishDrag()
@@ -1231,7 +2014,18 @@ void ToolWindowManager::finishDrag()
     qWarning("unexpected finishDrag");
     return;
   }
-  qApp->removeEventFilter(this);
+
+  QElapsedTimer timer;
+  if(m_dragStatisticsEnabled)
+    timer.start();
+
+  releaseDragInput();
+  m_dragUpdateTimer->stop();
+  m_dragUpdatePending = false;
+
+  // the last update may have been coalesced away or run for an earlier position, so find the drop
+  // target under the cursor now
+  updateDragFeedback(QCursor::pos());
 
   // move these locally to prevent re-entrancy
   QList<QWidget *> draggedToolWindows = m_draggedToolWindows;
@@ -1239,14 +2033,11 @@ void ToolWindowManager::finishDrag()
 
   m_draggedToolWindows.clear();
   m_draggedWrapper = NULL;
+  m_dragHitCacheValid = false;
 
-  AreaReferenceType hotspot = currentHotspot();
+  AreaReferenceType hotspot = currentHotspot(QCursor::pos());
 
-  m_previewOverlay->hide();
-  m_previewTabOverlay->hide();
-  for(QWidget *h : m_dropHotspots)
-    if(h)
-      h->hide();
+  hideDragOverlays();
 
   if(hotspot == NewFloatingArea)
   {
@@ -1289,6 +2080,21 @@ void ToolWindowManager::finishDrag()
       moveToolWindows(draggedToolWindows, AreaReference(EmptySpace));
     }
   }
+
+  if(m_dragStatisticsEnabled)
+    m_dragStatistics.finishTime = timer.nsecsElapsed();
+
+  emitDragStatistics(false);
+}
+
+void ToolWindowManager::emitDragStatistics(bool aborted)
+{
+  if(!m_dragStatisticsEnabled)
+    return;
+
+  m_dragStatistics.aborted = aborted;
+  m_dragStatistics.coalescedUpdates = m_dragUpdatesCoalesced;
+  emit dragStatistics(m_dragStatistics);
 }
 
 void ToolWindowManager::drawHotspotPixmaps()
@@ -1392,32 +2198,34 @@ void ToolWindowManager::drawHotspotPixmaps()
   m_pixmaps[BottomWindowSide] = m_pixmaps[BottomOf];
 }
 
-ToolWindowManager::AreaReferenceType ToolWindowManager::currentHotspot()
+ToolWindowManager::AreaReferenceType ToolWindowManager::currentHotspot(const QPoint &pos) const
 {
-  QPoint pos = QCursor::pos();
-
   for(int i = 0; i < NumReferenceTypes; i++)
   {
-    if(m_dropHotspots[i] && m_dropHotspots[i]->isVisible() &&
-       m_dropHotspots[i]->geometry().contains(pos))
+    if(m_hotspotRects[i].contains(pos))
     {
       return (ToolWindowManager::AreaReferenceType)i;
     }
   }
 
-  if(m_hoverArea)
-  {
-    QTabBar *tb = m_hoverArea->tabBar();
-    if(tb->rect().contains(tb->mapFromGlobal(QCursor::pos())))
-      return AddTo;
-  }
+  // dropping anywhere on the hovered area's tab bar adds to the area
+  if(m_hoverTabBarRect.contains(pos))
+    return AddTo;
 
   return NewFloatingArea;
 }
 
 bool ToolWindowManager::eventFilter(QObject *object, QEvent *event)
 {
-  if(event->type() == QEvent::MouseButtonRelease)
+  if(event->type() == QEvent::Move || event->type() == QEvent::Resize)
+  {
+    // a top level window moving doesn't move the wrappers inside it relative to their parents, so
+    // they get no move event of their own. The dragged wrapper is never a drop target.
+    if(object->isWindowType() &&
+       !(m_draggedWrapper && m_draggedWrapper->windowHandle() == static_cast<QWindow *>(object)))
+      invalidateDragHitCache();
+  }
+  else if(event->type() == QEvent::MouseButtonRelease)
   {
     // right clicking aborts any drag in progress
     if(static_cast<QMouseEvent *>(event)->button() == Qt::RightButton)
@@ -1437,7 +2245,7 @@ bool ToolWindowManager::eventFilter(QObject *object, QEvent *event)
 
 bool ToolWindowManager::allowClose(QWidget *toolWindow)
 {
-  if(!m_toolWindows.contains(toolWindow))
+  if(!isToolWindow(toolWindow))
   {
     qWarning("unknown tool window");
     return true;
@@ -1467,7 +2275,7 @@ void ToolWindowManager::tabCloseRequested(int index)
     return;
   }
   QWidget *toolWindow = tabWidget->widget(index);
-  if(!m_toolWindows.contains(toolWindow))
+  if(!isToolWindow(toolWindow))
   {
     qWarning("unknown tab in tab widget");
     return;
@@ -1482,6 +2290,38 @@ void ToolWindowManager::tabCloseRequested(int index)
     removeToolWindow(toolWindow, true);
 }
 
+void ToolWindowManager::indexToolWindowName(ToolWindowRecord &record, const QString &name)
+{
+  record.name = name;
+
+  if(name.isEmpty())
+    return;
+
+  // names are rarely shared, so the list is short and an insertion scan is cheap
+  QList<QWidget *> &named = m_toolWindowsByName[name];
+  int index = named.count();
+  while(index > 0 && toolWindowRecord(named[index - 1])->addedOrder > record.addedOrder)
+    index--;
+  named.insert(index, record.toolWindow);
+}
+
+void ToolWindowManager::unindexToolWindowName(ToolWindowRecord &record)
+{
+  QString name = record.name;
+  record.name = QString();
+
+  if(name.isEmpty())
+    return;
+
+  QHash<QString, QList<QWidget *> >::iterator it = m_toolWindowsByName.find(name);
+  if(it == m_toolWindowsByName.end())
+    return;
+
+  it->removeOne(record.toolWindow);
+  if(it->isEmpty())
+    m_toolWindowsByName.erase(it);
+}
+
 void ToolWindowManager::windowTitleChanged(const QString &)
 {
   QWidget *toolWindow = qobject_cast<QWidget *>(sender());
@@ -1496,13 +2336,162 @@ void ToolWindowManager::windowTitleChanged(const QString &)
   }
 }
 
+void ToolWindowManager::toolWindowNameChanged(const QString &name)
+{
+  ToolWindowRecord *record = toolWindowRecord(qobject_cast<QWidget *>(sender()));
+  if(!record)
+  {
+    return;
+  }
+  unindexToolWindowName(*record);
+  indexToolWindowName(*record, name);
+}
+
 QSplitter *ToolWindowManager::createSplitter()
 {
-  QSplitter *splitter = new ToolWindowManagerSplitter();
+  if(!m_splitterPool.isEmpty())
+  {
+    m_poolStatistics.splitterHits++;
+    return m_splitterPool.takeLast();
+  }
+
+  m_poolStatistics.splitterMisses++;
+  ToolWindowManagerSplitter *splitter = new ToolWindowManagerSplitter();
+  splitter->m_poolable = true;
   splitter->setChildrenCollapsible(false);
   return splitter;
 }
 
+void ToolWindowManager::buildLayout(const LayoutNode &root, ToolWindowProperty properties)
+{
+  // check the whole tree before changing anything
+  QList<QWidget *> toolWindows;
+  QSet<QWidget *> seen;
+  QList<const LayoutNode *> nodes;
+  nodes << &root;
+  while(!nodes.isEmpty())
+  {
+    // children go on the stack last first, so tool windows are listed in document order
+    const LayoutNode *node = nodes.takeLast();
+    for(int i = node->m_children.count() - 1; i >= 0; i--)
+      nodes << &node->m_children[i];
+    if(node->m_isArea ? node->m_toolWindows.isEmpty() : node->m_children.isEmpty())
+    {
+      qWarning("layout has an empty area or splitter");
+      return;
+    }
+    foreach(QWidget *toolWindow, node->m_toolWindows)
+    {
+      if(!toolWindow)
+      {
+        qWarning("cannot add null widget");
+        return;
+      }
+      if(seen.contains(toolWindow))
+      {
+        qWarning("tool window appears more than once in the layout");
+        return;
+      }
+      seen.insert(toolWindow);
+      toolWindows << toolWindow;
+    }
+  }
+
+  // the layout replaces the main wrapper's, which has to be emptied by moving its tool windows
+  foreach(QWidget *toolWindow, m_mainWrapper->toolWindows())
+  {
+    if(!seen.contains(toolWindow))
+    {
+      qWarning("main wrapper is not empty");
+      return;
+    }
+  }
+
+  LayoutChangeGuard guard(this);
+
+  QList<QWidget *> added, moved;
+  foreach(QWidget *toolWindow, toolWindows)
+  {
+    if(!isToolWindow(toolWindow))
+      added << toolWindow;
+    else if(areaOf(toolWindow))
+      moved << toolWindow;
+  }
+  if(!added.isEmpty())
+    addToolWindows(added, NoArea, properties);
+  if(!moved.isEmpty())
+    moveToolWindows(moved, NoArea);
+
+  // the main wrapper's old, now empty, areas and splitters are simplified away with the rest when
+  // the layout change is committed
+  m_mainWrapper->layout()->addWidget(buildLayoutNode(root, m_mainWrapper));
+  layoutChanged(QList<ToolWindowManagerWrapper *>() << m_mainWrapper);
+  visibilityMayHaveChanged(toolWindows);
+}
+
+QWidget *ToolWindowManager::buildLayoutNode(const LayoutNode &node, QWidget *parent)
+{
+  if(node.m_isArea)
+  {
+    ToolWindowManagerArea *area = createArea(parent);
+    area->addToolWindows(node.m_toolWindows);
+    if(node.m_currentIndex >= 0 && node.m_currentIndex < area->count())
+      area->setCurrentIndex(node.m_currentIndex);
+    return area;
+  }
+
+  // the splitter isn't in the layout until it's complete, so filling it doesn't lay anything out
+  QSplitter *splitter = createSplitter();
+  setSplitterOrientation(splitter, node.m_orientation);
+
+  QList<qreal> ratios;
+  for(int i = 0; i < node.m_children.count(); i++)
+  {
+    splitter->addWidget(buildLayoutNode(node.m_children[i], splitter));
+    ratios << (node.m_ratios.count() == node.m_children.count() ? node.m_ratios[i] : 1.0);
+  }
+
+  // the splitter has no size yet, so sizes are set on an arbitrary scale that it keeps the
+  // proportions of once it's laid out
+  qreal total = 0;
+  foreach(qreal ratio, ratios)
+    total += qMax(ratio, qreal(0));
+  QList<int> sizes;
+  foreach(qreal ratio, ratios)
+    sizes << (total > 0 ? qRound(qMax(ratio, qreal(0)) * 10000 / total) : 10000 / ratios.count());
+  splitter->setSizes(sizes);
+
+  return splitter;
+}
+
+ToolWindowManager::LayoutNode::LayoutNode()
+{
+  m_isArea = true;
+  m_currentIndex = 0;
+  m_orientation = Qt::Horizontal;
+}
+
+ToolWindowManager::LayoutNode ToolWindowManager::LayoutNode::area(
+    const QList<QWidget *> &toolWindows, int currentIndex)
+{
+  LayoutNode node;
+  node.m_isArea = true;
+  node.m_toolWindows = toolWindows;
+  node.m_currentIndex = currentIndex;
+  return node;
+}
+
+ToolWindowManager::LayoutNode ToolWindowManager::LayoutNode::splitter(
+    Qt::Orientation orientation, const QList<LayoutNode> &children, const QList<qreal> &ratios)
+{
+  LayoutNode node;
+  node.m_isArea = false;
+  node.m_orientation = orientation;
+  node.m_children = children;
+  node.m_ratios = ratios;
+  return node;
+}
+
 ToolWindowManager::AreaReference::AreaReference(ToolWindowManager::AreaReferenceType type,
                                                 ToolWindowManagerArea *area, float percentage)
 {
@@ -26,17 +26,25 @@
 #define TOOLWINDOWMANAGER_H
 
 #include <QHash>
-#include <QLabel>
+#include <QPixmap>
+#include <QPointer>
+#include <QSet>
 #include <QVariant>
+#include <QVector>
 #include <QWidget>
 
 #include <functional>
 
 class ToolWindowManagerArea;
+class ToolWindowManagerOverlay;
+class ToolWindowManagerSplitter;
 class ToolWindowManagerWrapper;
 
 class QLabel;
+class QScreen;
 class QSplitter;
+class QTimer;
+class QWindow;
 
 /*!
  * \brief The ToolWindowManager class provides docking tool behavior.
@@ -190,6 +198,20 @@ public:
    */
   ToolWindowProperty toolWindowProperties(QWidget *toolWindow);
 
+  /*!
+   * Sets \a data to be saved along with \a toolWindow by saveState(). It's updated by
+   * restoreState().
+   *
+   * Until this is called the tool window's "persistData" dynamic property is saved, as it was
+   * before this function existed.
+   */
+  void setToolWindowPersistData(QWidget *toolWindow, const QVariant &data);
+
+  /*!
+   * Returns the data saved along with \a toolWindow, see setToolWindowPersistData().
+   */
+  QVariant toolWindowPersistData(QWidget *toolWindow);
+
   /*!
    * \brief Adds \a toolWindows to the manager and moves it to the position specified by
    * \a area.
@@ -201,6 +223,9 @@ public:
    * If you intend to use ToolWindowManager::saveState
    * and ToolWindowManager::restoreState functions, you must set objectName() of each added
    * tool window to a non-empty unique string.
+   *
+   * Adding many tool windows with one call is much faster than adding them one by one, since
+   * the layout is updated and simplified only once.
    */
   void addToolWindows(QList<QWidget *> toolWindows, const AreaReference &area,
                       ToolWindowProperty properties = ToolWindowProperty(0));
@@ -224,6 +249,86 @@ public:
    */
   void moveToolWindows(QList<QWidget *> toolWindows, AreaReference area);
 
+  /*!
+   * \brief Starts a layout change. Until the matching commitLayoutChange(), tool windows
+   * are moved without simplifying the layout, updating wrapper titles or emitting visibility
+   * signals, and the existing wrappers don't repaint. Layout changes can be nested.
+   *
+   * Many moves made in one layout change are much faster than the same moves made on their own.
+   */
+  void beginLayoutChange();
+  /*!
+   * \brief Ends a layout change started with beginLayoutChange(). When the outermost layout
+   * change ends, the layout is simplified once, titles are updated, the visibility signals are
+   * emitted and the wrappers repaint.
+   */
+  void commitLayoutChange();
+  //! Returns true between beginLayoutChange() and the matching commitLayoutChange().
+  bool layoutChangeInProgress() const { return m_layoutChangeDepth > 0; }
+
+  /*!
+   * \brief Begins a layout change on construction and commits it on destruction.
+   */
+  class LayoutChangeGuard
+  {
+  public:
+    explicit LayoutChangeGuard(ToolWindowManager *manager) : m_manager(manager)
+    {
+      m_manager->beginLayoutChange();
+    }
+    ~LayoutChangeGuard() { m_manager->commitLayoutChange(); }
+
+  private:
+    Q_DISABLE_COPY(LayoutChangeGuard)
+    ToolWindowManager *m_manager;
+  };
+
+  /*!
+   * \brief The LayoutNode class describes an area or a splitter in a layout built by
+   * ToolWindowManager::buildLayout.
+   */
+  class LayoutNode
+  {
+  public:
+    /*!
+     * Creates an area node with a tab for each of \a toolWindows. The tab at \a currentIndex
+     * is selected.
+     */
+    static LayoutNode area(const QList<QWidget *> &toolWindows, int currentIndex = 0);
+    /*!
+     * Creates a splitter node with \a orientation holding \a children. \a ratios gives the
+     * relative size of each child. If it doesn't have one value per child, the children are
+     * given equal sizes.
+     */
+    static LayoutNode splitter(Qt::Orientation orientation, const QList<LayoutNode> &children,
+                               const QList<qreal> &ratios = QList<qreal>());
+    //! Returns true for an area node, false for a splitter node.
+    bool isArea() const { return m_isArea; }
+
+  private:
+    LayoutNode();
+    bool m_isArea;
+    QList<QWidget *> m_toolWindows;
+    int m_currentIndex;
+    Qt::Orientation m_orientation;
+    QList<LayoutNode> m_children;
+    QList<qreal> m_ratios;
+
+    friend class ToolWindowManager;
+  };
+
+  /*!
+   * \brief Builds the layout described by \a root in the main window in one pass. Each area and
+   * splitter is created directly in its final place, and the layout is simplified once.
+   *
+   * Tool windows in \a root that aren't added to the manager yet are added with \a properties, in
+   * the order they appear in \a root. Tool windows that are already added are moved.
+   *
+   * Nothing is changed if \a root has a null or repeated tool window or an empty area or
+   * splitter, or if the main window has tool windows that aren't in \a root.
+   */
+  void buildLayout(const LayoutNode &root, ToolWindowProperty properties = ToolWindowProperty(0));
+
   /*!
    * \brief Removes \a toolWindow from the manager. \a toolWindow becomes a hidden
    * top level widget. The ownership of \a toolWindow is returned to the caller.
@@ -273,6 +378,89 @@ public:
   bool allowFloatingWindow() { return m_allowFloatingWindow; }
   /*! \endcond */
 
+  /*!
+   * Returns how many redundant drag position updates were absorbed during the current or most
+   * recent drag. Drag updates are coalesced so that at most one runs per display frame.
+   */
+  int coalescedDragUpdates() const { return m_dragUpdatesCoalesced; }
+
+  /*!
+   * \brief Timings and counters gathered over one drag while drag statistics are enabled.
+   * All times are in nanoseconds.
+   */
+  struct DragStatistics
+  {
+    //! Number of buckets in the update latency histogram.
+    static const int LatencyBuckets = 16;
+
+    //! Whether the drag was aborted instead of dropped.
+    bool aborted = false;
+    //! Number of drag position updates processed.
+    int updates = 0;
+    //! Number of redundant drag position updates merged into another update.
+    int coalescedUpdates = 0;
+    //! updateLatency[i] counts the updates that took less than 2^i microseconds but at least
+    //! 2^(i-1). The last bucket also counts every slower update.
+    int updateLatency[LatencyBuckets] = {};
+    //! Total and longest time spent processing a drag position update.
+    qint64 totalUpdateTime = 0;
+    qint64 maxUpdateTime = 0;
+    //! Total time spent resolving the hotspot under the cursor.
+    qint64 hotspotTime = 0;
+    //! Time spent docking the tool windows at the end of the drag, 0 if it was aborted.
+    qint64 finishTime = 0;
+    //! Number of drop target hit-tests against the cursor.
+    int hitTests = 0;
+    //! Number of widget positions mapped to or from global coordinates.
+    int globalMappings = 0;
+    //! Number of times the previews or hotspots shown on the overlays changed.
+    int overlayUpdates = 0;
+  };
+
+  /*!
+   * Enables or disables gathering drag statistics. While enabled, the dragStatistics() signal
+   * is emitted at the end of every drag. Disabled by default.
+   */
+  void setDragStatisticsEnabled(bool enabled) { m_dragStatisticsEnabled = enabled; }
+  bool dragStatisticsEnabled() const { return m_dragStatisticsEnabled; }
+
+  /*!
+   * Enables or disables the per tool window toolWindowVisibilityChanged() signal. The batched
+   * toolWindowsVisibilityChanged() signal is always emitted. Enabled by default.
+   */
+  void setToolWindowVisibilitySignalEnabled(bool enabled)
+  {
+    m_toolWindowVisibilitySignalEnabled = enabled;
+  }
+  bool toolWindowVisibilitySignalEnabled() const { return m_toolWindowVisibilitySignalEnabled; }
+
+  /*!
+   * \brief Counters for the pools of areas and splitters that are kept for reuse instead of
+   * being deleted when they're no longer used in the layout.
+   */
+  struct PoolStatistics
+  {
+    //! Number of areas and splitters taken from the pools.
+    int areaHits = 0;
+    int splitterHits = 0;
+    //! Number of areas and splitters created because the pools were empty.
+    int areaMisses = 0;
+    int splitterMisses = 0;
+    //! Number of areas and splitters put back into the pools.
+    int areasRecycled = 0;
+    int splittersRecycled = 0;
+  };
+
+  /*!
+   * Sets the number of unused areas, and separately of unused splitters, that are kept for reuse.
+   * 0 disables the pools. The default is 8.
+   */
+  void setPoolCapacity(int capacity);
+  int poolCapacity() const { return m_poolCapacity; }
+  //! Returns the pool counters gathered since the last resetPoolStatistics().
+  const PoolStatistics &poolStatistics() const { return m_poolStatistics; }
+  void resetPoolStatistics() { m_poolStatistics = PoolStatistics(); }
+
 signals:
   /*!
    * \brief This signal is emitted when \a toolWindow may be hidden or shown.
@@ -280,21 +468,92 @@ signals:
    */
   void toolWindowVisibilityChanged(QWidget *toolWindow, bool visible);
 
+  /*!
+   * \brief This signal is emitted once per operation that may hide or show tool windows, such as
+   * moveToolWindows() or restoreState(), after any toolWindowVisibilityChanged() signals.
+   * \a shown and \a hidden hold the affected tool windows by their new visibility state.
+   */
+  void toolWindowsVisibilityChanged(const QList<QWidget *> &shown, const QList<QWidget *> &hidden);
+
+  /*!
+   * \brief This signal is emitted when a drag ends while drag statistics are enabled, with
+   * the \a statistics gathered over the drag.
+   */
+  void dragStatistics(const ToolWindowManager::DragStatistics &statistics);
+
 private:
-  QList<QWidget *> m_toolWindows;                                 // all added tool windows
-  QHash<QWidget *, ToolWindowProperty> m_toolWindowProperties;    // all tool window properties
+  QList<QWidget *> m_toolWindows;    // all added tool windows, in the order they were added
+
+  // everything the manager tracks for one added tool window. Records are stored contiguously and
+  // a record's index is a handle to it that stays valid until its tool window is removed, after
+  // which the slot is reused.
+  struct ToolWindowRecord
+  {
+    QWidget *toolWindow;    // NULL for a free slot
+    ToolWindowProperty properties;
+    // the area with the tool window's tab, updated as tabs are added and released. NULL while the
+    // tool window is hidden. Its wrapper is cached by the area.
+    ToolWindowManagerArea *area;
+    QString name;            // the objectName() the tool window is indexed under
+    quint64 addedOrder;      // when the tool window was added, relative to the others
+    QVariant persistData;    // data saved with the tool window, see setToolWindowPersistData()
+    bool hasPersistData;     // else the "persistData" dynamic property is saved
+    int nextFree;            // the next free slot, for free slots
+  };
+  QVector<ToolWindowRecord> m_toolWindowRecords;
+  QHash<QWidget *, int> m_toolWindowHandles;    // the handle of each added tool window
+  int m_freeToolWindowRecord;                    // the first free slot, or -1
+  quint64 m_toolWindowsAdded;                    // the addedOrder for the next record
+  bool isToolWindow(QWidget *toolWindow) const { return m_toolWindowHandles.contains(toolWindow); }
+  ToolWindowRecord *toolWindowRecord(QWidget *toolWindow);
+  void addToolWindowRecord(QWidget *toolWindow, ToolWindowProperty properties);
+  void removeToolWindowRecord(QWidget *toolWindow);
+  void restoreToolWindowPersistData(QWidget *toolWindow, const QVariant &data);
+  static QVariant recordPersistData(const ToolWindowRecord &record);
+
+  // added tool windows by objectName(), kept up to date as names change. Tool windows sharing a
+  // name are listed in the order they were added, so the first one is found.
+  QHash<QString, QList<QWidget *> > m_toolWindowsByName;
+  void indexToolWindowName(ToolWindowRecord &record, const QString &name);
+  void unindexToolWindowName(ToolWindowRecord &record);
+  QWidget *toolWindowByName(const QString &name) const
+  {
+    return m_toolWindowsByName.value(name).value(0);
+  }
   QList<ToolWindowManagerArea *> m_areas;                         // all areas for this manager
   QList<ToolWindowManagerWrapper *> m_wrappers;                   // all wrappers for this manager
+  ToolWindowManagerWrapper *m_mainWrapper;    // the wrapper inside the manager widget itself
+  // all wrappers in stacking order, front to back. The main wrapper is always last.
+  QList<ToolWindowManagerWrapper *> m_wrapperZOrder;
+  void raiseWrapper(ToolWindowManagerWrapper *wrapper);    // a wrapper came to the front
   // list of tool windows that are currently dragged, or empty list if there is no current drag
   QList<QWidget *> m_draggedToolWindows;
   ToolWindowManagerWrapper
       *m_draggedWrapper;                 // the wrapper if a whole float window is being dragged
   ToolWindowManagerArea *m_hoverArea;    // the area currently being hovered over in a drag
-  // a semi-transparent preview of where the dragged toolwindow(s) will be docked
+  // a semi-transparent preview of where the dragged toolwindow(s) will be docked, and the hotspot
+  // icons to pick the dock location. All in global coordinates, empty when not displayed.
+  QRect m_previewRect;
+  QRect m_previewTabRect;
+  QRect m_hotspotRects[NumReferenceTypes];
+  QPixmap m_pixmaps[NumReferenceTypes];
+  // transparent windows that the previews and hotspots are painted on, one for each screen. Each
+  // covers its screen's part of m_dragOverlayBounds, which starts as the wrappers' rects at the
+  // start of a drag and only grows to take in previews outside them.
+  QHash<QScreen *, ToolWindowManagerOverlay *> m_overlays;
+  QRect m_dragOverlayBounds;
+
+  // without a compositor translucent windows are drawn opaque, so the previews and hotspots are
+  // each shown in a separate window instead, created the first time they're needed
+  bool translucentOverlaysSupported() const;
   QWidget *m_previewOverlay;
   QWidget *m_previewTabOverlay;
   QLabel *m_dropHotspots[NumReferenceTypes];
-  QPixmap m_pixmaps[NumReferenceTypes];
+  void createFallbackOverlays();
+  void updateFallbackOverlays();
+
+  void updateDragOverlays();
+  void hideDragOverlays();
 
   bool m_allowFloatingWindow;    // Allow floating windows from this docking area
   int m_dropHotspotMargin;       // The pixels between drop hotspot icons
@@ -310,44 +569,204 @@ private:
 
   void removeToolWindow(QWidget *toolWindow, bool allowCloseAlreadyChecked);
 
-  // last widget used for adding tool windows, or 0 if there isn't one
-  // (warning: may contain pointer to deleted object)
-  ToolWindowManagerArea *m_lastUsedArea;
+  // areas tool windows were added to, most recently used first. Areas are forgotten when they're
+  // emptied or destroyed, so the front is always the last used area that's still around.
+  QList<QPointer<ToolWindowManagerArea>> m_areaUseOrder;
+  void touchArea(ToolWindowManagerArea *area);
+  void forgetArea(ToolWindowManagerArea *area);
+  // last area used for adding tool windows, or 0 if there isn't one
+  ToolWindowManagerArea *lastUsedArea() const
+  {
+    return m_areaUseOrder.isEmpty() ? NULL : m_areaUseOrder.first().data();
+  }
+  // tool windows that may have been hidden or shown are collected while a batch is open, and the
+  // visibility signals are emitted for all of them when the outermost batch ends
+  bool m_toolWindowVisibilitySignalEnabled;
+  int m_visibilityBatchDepth;
+  QList<QWidget *> m_visibilityChanged;
+  void beginVisibilityBatch() { m_visibilityBatchDepth++; }
+  void endVisibilityBatch();
+  void visibilityMayHaveChanged(const QList<QWidget *> &toolWindows);
+  // while a layout change is in progress, wrappers whose titles need updating and wrappers that
+  // had their updates disabled are collected here until it's committed
+  int m_layoutChangeDepth;
+  QList<QPointer<ToolWindowManagerWrapper>> m_layoutChangeTitles;
+  QList<QPointer<ToolWindowManagerWrapper>> m_layoutChangeUpdatesDisabled;
+  QList<QPointer<ToolWindowManagerWrapper>> m_layoutChangeShows;
+  // show a new floating wrapper, or defer it to commitLayoutChange() so it first appears with its
+  // final layout and title
+  void showFloatingWrapper(ToolWindowManagerWrapper *wrapper);
+  // simplify the layout and update the titles of wrappers, or defer both to commitLayoutChange()
+  void layoutChanged(const QList<ToolWindowManagerWrapper *> &wrappersToUpdate);
+  // create the widget for a node of buildLayout() in parent. The node has been checked to not be
+  // empty.
+  QWidget *buildLayoutNode(const LayoutNode &node, QWidget *parent);
   // remove tool window from its area (if any) and set parent to 0
   void releaseToolWindow(QWidget *toolWindow);
-  void simplifyLayout();    // remove constructions that became useless
+  // place released tool windows at area, then simplify and update titles once for all of them
+  void placeToolWindows(const QList<QWidget *> &toolWindows, AreaReference area,
+                        QList<ToolWindowManagerWrapper *> wrappersToUpdate);
+  // areas and splitters that were removed from the layout, kept for reuse by the default
+  // createArea() and createSplitter(). Only what those created is pooled. Areas in the pool are
+  // parentless, empty, hold no hidden tool windows and are not in m_areas. Only empty splitters
+  // are pooled.
+  int m_poolCapacity;
+  QList<ToolWindowManagerArea *> m_areaPool;
+  QList<QSplitter *> m_splitterPool;
+  PoolStatistics m_poolStatistics;
+  // put an area or a splitter that's no longer used into the pools, or delete it if it can't be
+  void releaseArea(ToolWindowManagerArea *area);
+  void releaseSplitter(QSplitter *splitter);
+  // set the orientation of a splitter, giving one that createSplitter() made the size policy a new
+  // QSplitter has for that orientation
+  void setSplitterOrientation(QSplitter *splitter, Qt::Orientation orientation);
+  // while open, splitters in this manager's layout keep the sizes worked out for removed children
+  // and apply them once when the outermost batch ends
+  int m_removalBatchDepth;
+  QList<QPointer<ToolWindowManagerSplitter>> m_pendingSplitters;
+  void beginRemovalBatch() { m_removalBatchDepth++; }
+  void endRemovalBatch();
+  // the sizes of splitter with any it's holding back for the end of the batch applied first
+  QList<int> splitterSizes(QSplitter *splitter);
+  // set sizes explicitly, replacing any the splitter is holding back for the end of the batch
+  void setSplitterSizes(QSplitter *splitter, const QList<int> &sizes);
+  // areas that were created, or had tool windows added or removed, since the last simplification
+  QList<ToolWindowManagerArea *> m_dirtyAreas;
+  void markLayoutDirty(ToolWindowManagerArea *area);
+  // remove constructions that became useless, starting from the dirty areas
+  void simplifyLayout();
+  bool simplifyArea(ToolWindowManagerArea *area, QList<QSplitter *> &dirtySplitters);
   void startDrag(const QList<QWidget *> &toolWindows, ToolWindowManagerWrapper *wrapper);
 
   QVariantMap saveSplitterState(QSplitter *splitter);
   QSplitter *restoreSplitterState(const QVariantMap &data);
 
-  AreaReferenceType currentHotspot();
+  // the hotspot at pos in global coordinates, looked up in the rects laid out for the current
+  // drop target
+  AreaReferenceType currentHotspot(const QPoint &pos) const;
+
+  // global geometry of every possible drop target, built when a drag starts so that hit-testing
+  // the cursor doesn't need to map every area and wrapper on each mouse move. Areas are bucketed
+  // into a uniform grid of cells, each cell lists the areas overlapping it in m_areas order.
+  // Wrappers are listed front to back.
+  struct DragHitArea
+  {
+    QRect rect;
+    ToolWindowManagerArea *area;
+    ToolWindowManagerWrapper *wrapper;    // the wrapper containing the area
+  };
+  QVector<DragHitArea> m_dragHitAreas;
+  QVector<QPair<QRect, ToolWindowManagerWrapper *>> m_dragHitWrappers;
+  QHash<quint64, QVector<int>> m_dragHitGrid;
+  bool m_dragHitCacheValid;    // false if a wrapper moved or resized since the cache was built
+  int m_dragHitGeneration;     // incremented each time the cache is rebuilt
+
+  void buildDragHitCache();
+  void invalidateDragHitCache() { m_dragHitCacheValid = false; }
+  ToolWindowManagerArea *dragHitArea(ToolWindowManagerWrapper *wrapper, const QPoint &pos);
+  ToolWindowManagerWrapper *dragHitWrapper(const QPoint &pos);
+
+  // global geometry of a splitter's visible children and the handles between them, sorted along
+  // the splitter's orientation. Built the first time a drag descends into a splitter, so finding
+  // the child or handle under the cursor is a binary search.
+  struct DragSplitterSegment
+  {
+    QRect rect;
+    QWidget *before;    // the child widget, or the child before the handle
+    QWidget *after;     // NULL for a child widget, or the child after the handle
+  };
+  QHash<QSplitter *, QVector<DragSplitterSegment>> m_dragSplitterSegments;
+  const DragSplitterSegment *dragSplitterSegmentAt(QSplitter *splitter, const QPoint &pos);
+
+  // drag updates are requested from several event sources for the same physical mouse motion, so
+  // they are limited to one per display frame. The first request in a frame is processed
+  // immediately, any further ones are merged into a single update when the frame ends.
+  QTimer *m_dragUpdateTimer;
+  bool m_dragUpdatePending;      // an update was requested while m_dragUpdateTimer was running
+  int m_dragUpdatesCoalesced;    // redundant update requests absorbed during this drag
+
+  bool m_dragStatisticsEnabled;
+  DragStatistics m_dragStatistics;    // statistics for the drag in progress
+  void emitDragStatistics(bool aborted);
+
+  // top level windows the manager filters while a drag is in progress, to abort the drag on a right
+  // click or escape. Only these windows' own events are filtered, which are the raw input events
+  // before they're delivered to widgets, so no other event in the application is intercepted.
+  QList<QPointer<QWindow>> m_dragInputWindows;
+  void grabDragInput();
+  void releaseDragInput();
+
+  // the inputs the drag feedback was last computed from. The hotspots and preview only need to be
+  // recomputed when the cursor moves onto a different target, the targets' geometry changes, or a
+  // different hotspot or tab is hovered.
+  struct DragFeedback
+  {
+    DragFeedback()
+        : area(NULL), wrapper(NULL), hitGeneration(-1), hotspot(NewFloatingArea), tabIndex(-1)
+    {
+    }
+
+    ToolWindowManagerArea *area;
+    ToolWindowManagerWrapper *wrapper;
+    int hitGeneration;    // the m_dragHitGeneration the hotspots were laid out for
+    AreaReferenceType hotspot;
+    int tabIndex;         // the hovered tab, when adding to an area with several tabs
+    QPoint floatPos;      // the cursor position, only when a tear-off preview follows it
+
+    bool operator==(const DragFeedback &o) const
+    {
+      return area == o.area && wrapper == o.wrapper && hitGeneration == o.hitGeneration &&
+             hotspot == o.hotspot && tabIndex == o.tabIndex && floatPos == o.floatPos;
+    }
+  };
+  DragFeedback m_dragFeedback;
+  // global geometry of the current drop target, cached when its hotspots are laid out
+  QRect m_hoverRect;
+  QRect m_hoverWrapperRect;
+  QRect m_hoverTabBarRect;
+  QVector<QRect> m_hoverTabRects;
+  QSize m_dragFloatPreviewSize;    // size of the tear-off preview, empty if there is none
+  void layoutDragHotspots(ToolWindowManagerWrapper *hoverWrapper);
 
   void updateDragPosition();
+  void processDragPosition();
+  void updateDragFeedback(const QPoint &pos);
   void abortDrag();
   void finishDrag();
   bool dragInProgress() { return !m_draggedToolWindows.isEmpty(); }
   friend class ToolWindowManagerArea;
+  friend class ToolWindowManagerOverlay;
+  friend class ToolWindowManagerSplitter;
   friend class ToolWindowManagerWrapper;
 
 protected:
-  //! Event filter for grabbing and processing drag aborts.
+  //! Event filter on top level windows for grabbing and processing drag aborts and for noticing
+  //! windows moving during a drag.
   virtual bool eventFilter(QObject *object, QEvent *event);
 
   /*!
    * \brief Creates new splitter and sets its default properties. You may reimplement
    * this function to change properties of all splitters used by this class.
+   *
+   * The default implementation reuses a splitter released from the layout if there is one, see
+   * setPoolCapacity(). Splitters made by a reimplementation that doesn't call it aren't reused.
    */
   virtual QSplitter *createSplitter();
   /*!
    * \brief Creates new area and sets its default properties. You may reimplement
    * this function to change properties of all tab widgets used by this class.
+   *
+   * The default implementation reuses an area released from the layout if there is one, see
+   * setPoolCapacity(). Areas made by a reimplementation that doesn't call it aren't reused.
    */
   virtual ToolWindowManagerArea *createArea(QWidget *owner = nullptr);
 
 private slots:
   void tabCloseRequested(int index);
   void windowTitleChanged(const QString &title);
+  void toolWindowNameChanged(const QString &name);
+  void dragUpdateTimeout();
+  void screenRemoved(QScreen *screen);
 };
 
 inline ToolWindowManager::ToolWindowProperty operator|(ToolWindowManager::ToolWindowProperty a,
@@ -356,4 +775,6 @@ inline ToolWindowManager::ToolWindowProperty operator|(ToolWindowManager::ToolWi
   return ToolWindowManager::ToolWindowProperty(int(a) | int(b));
 }
 
+Q_DECLARE_METATYPE(ToolWindowManager::DragStatistics)
+
 #endif    // TOOLWINDOWMANAGER_H
@@ -25,6 +25,7 @@
 #include "ToolWindowManagerArea.h"
 #include <QApplication>
 #include <QMouseEvent>
+#include <QStackedWidget>
 #include <algorithm>
 #include "ToolWindowManager.h"
 #include "ToolWindowManagerTabBar.h"
@@ -55,6 +56,11 @@ ToolWindowManagerArea::ToolWindowManagerArea(ToolWindowManager *manager, QWidget
   m_tabDragCanStart = false;
   m_inTabMoved = false;
   m_userCanDrop = true;
+  m_wrapper = NULL;
+  m_mostRecent = NULL;
+  m_layoutDirty = false;
+  m_poolable = false;
+  m_manager->markLayoutDirty(this);
   setMovable(true);
   setDocumentMode(true);
   tabBar()->installEventFilter(this);
@@ -69,6 +75,9 @@ ToolWindowManagerArea::ToolWindowManagerArea(ToolWindowManager *manager, QWidget
 ToolWindowManagerArea::~ToolWindowManagerArea()
 {
   m_manager->m_areas.removeOne(this);
+  m_manager->forgetArea(this);
+  if(m_layoutDirty)
+    m_manager->m_dirtyAreas.removeOne(this);
 }
 
 void ToolWindowManagerArea::addToolWindow(QWidget *toolWindow, int insertIndex)
@@ -78,18 +87,48 @@ void ToolWindowManagerArea::addToolWindow(QWidget *toolWindow, int insertIndex)
 
 void ToolWindowManagerArea::addToolWindows(const QList<QWidget *> &toolWindows, int insertIndex)
 {
+  // don't repaint the tab bar for every tab when adding many of them
+  bool batch = toolWindows.count() > 1 && updatesEnabled();
+  if(batch)
+    setUpdatesEnabled(false);
+
+  // the new tabs are inserted one after the other, so they end up at first..index. Their titles
+  // are set by insertTab(), only their close buttons have to be updated and existing tabs are
+  // left alone.
+  int first = -1;
   int index = 0;
   foreach(QWidget *toolWindow, toolWindows)
   {
     index = insertTab(insertIndex, toolWindow, toolWindow->windowIcon(), toolWindow->windowTitle());
     insertIndex = index + 1;
+    if(first < 0)
+      first = index;
+    if(ToolWindowManager::ToolWindowRecord *record = tabRecord(index))
+      record->area = this;
   }
   setCurrentIndex(index);
-  for(int i = 0; i < count(); i++)
+  for(int i = first; i >= 0 && i <= index; i++)
   {
-    updateToolWindow(widget(i));
+    updateCloseButton(i);
   }
-  m_manager->m_lastUsedArea = this;
+
+  if(batch)
+    setUpdatesEnabled(true);
+  m_manager->touchArea(this);
+  m_manager->markLayoutDirty(this);
+}
+
+ToolWindowManagerWrapper *ToolWindowManagerArea::wrapper()
+{
+  // areas are only ever moved between wrappers by reparenting the area itself, never one of the
+  // splitters above it, so the wrapper only needs to be looked up again after a parent change
+  if(m_wrapper)
+    return m_wrapper;
+
+  for(QWidget *w = parentWidget(); w && !m_wrapper; w = w->parentWidget())
+    m_wrapper = qobject_cast<ToolWindowManagerWrapper *>(w);
+
+  return m_wrapper;
 }
 
 QList<QWidget *> ToolWindowManagerArea::toolWindows()
@@ -107,15 +146,45 @@ void ToolWindowManagerArea::updateToolWindow(QWidget *toolWindow)
   int index = indexOf(toolWindow);
   if(index >= 0)
   {
-    ToolWindowManagerTabBar *tb = static_cast<ToolWindowManagerTabBar *>(tabBar());
-    if(m_manager->toolWindowProperties(toolWindow) & ToolWindowManager::HideCloseButton)
-      showCloseButton(tabBar(), index, false);
-    else
-      showCloseButton(tabBar(), index, true);
+    updateCloseButton(index);
     tabBar()->setTabText(index, toolWindow->windowTitle());
   }
 }
 
+ToolWindowManager::ToolWindowRecord *ToolWindowManagerArea::tabRecord(int index)
+{
+  bool ok = false;
+  int handle = tabBar()->tabData(index).toInt(&ok);
+  if(!ok || handle < 0 || handle >= m_manager->m_toolWindowRecords.count())
+    return NULL;
+
+  // a tab whose tool window was just removed can outlive its record, whose slot may be reused
+  ToolWindowManager::ToolWindowRecord &record = m_manager->m_toolWindowRecords[handle];
+  return record.toolWindow && record.toolWindow == widget(index) ? &record : NULL;
+}
+
+ToolWindowManager::ToolWindowProperty ToolWindowManagerArea::tabProperties(int index)
+{
+  ToolWindowManager::ToolWindowRecord *record = tabRecord(index);
+  return record ? record->properties : ToolWindowManager::ToolWindowProperty(0);
+}
+
+void ToolWindowManagerArea::updateCloseButton(int index)
+{
+  if(tabProperties(index) & ToolWindowManager::HideCloseButton)
+    showCloseButton(tabBar(), index, false);
+  else
+    showCloseButton(tabBar(), index, true);
+}
+
+bool ToolWindowManagerArea::event(QEvent *event)
+{
+  if(event->type() == QEvent::ParentChange)
+    m_wrapper = NULL;
+
+  return QTabWidget::event(event);
+}
+
 void ToolWindowManagerArea::mouseMoveEvent(QMouseEvent *)
 {
   check_mouse_move();
@@ -136,7 +205,7 @@ bool ToolWindowManagerArea::eventFilter(QObject *object, QEvent *event)
       {
         m_tabDragCanStart = true;
 
-        if(m_manager->toolWindowProperties(widget(tabIndex)) & ToolWindowManager::DisableDraggableTab)
+        if(tabProperties(tabIndex) & ToolWindowManager::DisableDraggableTab)
         {
           setMovable(false);
         }
@@ -157,9 +226,7 @@ bool ToolWindowManagerArea::eventFilter(QObject *object, QEvent *event)
 
       if(tabIndex >= 0)
       {
-        QWidget *w = widget(tabIndex);
-
-        if(!(m_manager->toolWindowProperties(w) & ToolWindowManager::HideCloseButton))
+        if(!(tabProperties(tabIndex) & ToolWindowManager::HideCloseButton))
         {
           emit tabCloseRequested(tabIndex);
         }
@@ -185,7 +252,7 @@ bool ToolWindowManagerArea::eventFilter(QObject *object, QEvent *event)
           return false;
         }
         QWidget *toolWindow = currentWidget();
-        if(!toolWindow || !m_manager->m_toolWindows.contains(toolWindow))
+        if(!toolWindow || !m_manager->isToolWindow(toolWindow))
         {
           return false;
         }
@@ -208,69 +275,148 @@ bool ToolWindowManagerArea::eventFilter(QObject *object, QEvent *event)
 
 void ToolWindowManagerArea::tabInserted(int index)
 {
-  // update the select order. Increment any existing index after the insertion point to keep the
-  // indices in the list up to date.
-  for(int &idx : m_tabSelectOrder)
-  {
-    if(idx >= index)
-      idx++;
-  }
+  QWidget *toolWindow = widget(index);
+
+  // remember the record handle so properties are read without looking the tool window up
+  tabBar()->setTabData(index, m_manager->m_toolWindowHandles.value(toolWindow, -1));
 
-  // if the tab inserted is the current index (most likely) then add it at the end, otherwise
-  // add it next-to-end (to keep the most recent tab the same).
-  if(currentIndex() == index || m_tabSelectOrder.isEmpty())
-    m_tabSelectOrder.append(index);
+  // if the tab inserted is the current index (most likely) then add it at the front, otherwise
+  // add it next-to-front (to keep the most recent tab the same).
+  unlinkSelectOrder(toolWindow);
+  if(currentIndex() == index || m_mostRecent == NULL)
+    linkSelectOrder(toolWindow, NULL);
   else
-    m_tabSelectOrder.insert(m_tabSelectOrder.count() - 1, index);
+    linkSelectOrder(toolWindow, m_mostRecent);
 
   QTabWidget::tabInserted(index);
 }
 
 void ToolWindowManagerArea::tabRemoved(int index)
 {
-  // update the select order. Remove the index that just got deleted, and decrement any index
-  // greater than it to remap to their new indices
-  m_tabSelectOrder.removeOne(index);
-
-  for(int &idx : m_tabSelectOrder)
+  // tool windows removed through removeToolWindow() are already unlinked. Anything else, like a
+  // tool window being deleted, has to be found by looking for the tab that's gone.
+  if(m_selectOrder.count() > count())
   {
-    if(idx > index)
-      idx--;
+    QWidget *toolWindow = m_mostRecent;
+    while(toolWindow)
+    {
+      QWidget *next = m_selectOrder[toolWindow].lessRecent;
+      if(indexOf(toolWindow) < 0)
+        unlinkSelectOrder(toolWindow);
+      toolWindow = next;
+    }
   }
 
+  m_manager->markLayoutDirty(this);
   QTabWidget::tabRemoved(index);
 }
 
 void ToolWindowManagerArea::tabSelected(int index)
 {
-  // move this tab to the end of the select order, as long as we have it - if it's a new index then
+  // move this tab to the front of the select order, as long as we have it - if it's a new tab then
   // ignore and leave it to be handled in tabInserted()
-  if(m_tabSelectOrder.contains(index))
+  QWidget *toolWindow = widget(index);
+  if(toolWindow && toolWindow != m_mostRecent && m_selectOrder.contains(toolWindow))
   {
-    m_tabSelectOrder.removeOne(index);
-    m_tabSelectOrder.append(index);
+    unlinkSelectOrder(toolWindow);
+    linkSelectOrder(toolWindow, NULL);
   }
 
-  ToolWindowManagerWrapper *wrapper = m_manager->wrapperOf(this);
-  if(wrapper)
+  if(ToolWindowManagerWrapper *wrapper = this->wrapper())
     wrapper->updateTitle();
 }
 
 void ToolWindowManagerArea::tabClosing(int index)
 {
   // before closing this index, switch the current index to the next tab in succession.
+  QWidget *toolWindow = widget(index);
+
+  // if the most recently selected tab is being closed, switch to the next most selected tab. When
+  // closing the last tab there's nothing to do
+  if(toolWindow && toolWindow == m_mostRecent)
+  {
+    QWidget *next = m_selectOrder[toolWindow].lessRecent;
+    if(next)
+      setCurrentWidget(next);
+  }
+}
 
-  // should never get here but let's check this
-  if(m_tabSelectOrder.isEmpty())
+void ToolWindowManagerArea::recycle()
+{
+  m_dragCanStart = false;
+  m_tabDragCanStart = false;
+  m_inTabMoved = false;
+  m_userCanDrop = true;
+  m_selectOrder.clear();
+  m_mostRecent = NULL;
+}
+
+void ToolWindowManagerArea::releaseHiddenToolWindows()
+{
+  QStackedWidget *stack = findChild<QStackedWidget *>(QString(), Qt::FindDirectChildrenOnly);
+  if(!stack)
     return;
 
-  // when closing the last tab there's nothing to do
-  if(m_tabSelectOrder.count() == 1)
+  // the stack's layout is among its children too
+  QObjectList children = stack->children();
+  foreach(QObject *child, children)
+  {
+    if(child->isWidgetType() && indexOf(static_cast<QWidget *>(child)) < 0)
+      static_cast<QWidget *>(child)->setParent(0);
+  }
+}
+
+void ToolWindowManagerArea::removeToolWindow(QWidget *toolWindow)
+{
+  unlinkSelectOrder(toolWindow);
+  removeTab(indexOf(toolWindow));
+}
+
+QList<QWidget *> ToolWindowManagerArea::recentToolWindows() const
+{
+  QList<QWidget *> result;
+  result.reserve(m_selectOrder.count());
+  for(QWidget *toolWindow = m_mostRecent; toolWindow;
+      toolWindow = m_selectOrder.value(toolWindow).lessRecent)
+  {
+    result << toolWindow;
+  }
+  return result;
+}
+
+void ToolWindowManagerArea::linkSelectOrder(QWidget *toolWindow, QWidget *moreRecent)
+{
+  SelectOrderLink link;
+  link.moreRecent = moreRecent;
+  link.lessRecent = moreRecent ? m_selectOrder[moreRecent].lessRecent : m_mostRecent;
+
+  if(link.lessRecent)
+    m_selectOrder[link.lessRecent].moreRecent = toolWindow;
+
+  if(moreRecent)
+    m_selectOrder[moreRecent].lessRecent = toolWindow;
+  else
+    m_mostRecent = toolWindow;
+
+  m_selectOrder[toolWindow] = link;
+}
+
+void ToolWindowManagerArea::unlinkSelectOrder(QWidget *toolWindow)
+{
+  QHash<QWidget *, SelectOrderLink>::iterator it = m_selectOrder.find(toolWindow);
+  if(it == m_selectOrder.end())
     return;
 
-  // if the last in the select order is being closed, switch to the next most selected tab
-  if(m_tabSelectOrder.last() == index)
-    setCurrentIndex(m_tabSelectOrder.at(m_tabSelectOrder.count() - 2));
+  SelectOrderLink link = *it;
+  m_selectOrder.erase(it);
+
+  if(link.lessRecent)
+    m_selectOrder[link.lessRecent].moreRecent = link.moreRecent;
+
+  if(link.moreRecent)
+    m_selectOrder[link.moreRecent].lessRecent = link.lessRecent;
+  else
+    m_mostRecent = link.lessRecent;
 }
 
 QVariantMap ToolWindowManagerArea::saveState()
@@ -292,7 +438,9 @@ QVariantMap ToolWindowManagerArea::saveState()
     {
       QVariantMap objectData;
       objectData[QStringLiteral("name")] = name;
-      objectData[QStringLiteral("data")] = w->property("persistData");
+      ToolWindowManager::ToolWindowRecord *record = tabRecord(i);
+      objectData[QStringLiteral("data")] =
+          record ? ToolWindowManager::recordPersistData(*record) : QVariant();
       objects.push_back(objectData);
     }
   }
@@ -314,20 +462,12 @@ void ToolWindowManagerArea::restoreState(const QVariantMap &savedData)
     {
       continue;
     }
-    QWidget *t = NULL;
-    for(QWidget *toolWindow : m_manager->m_toolWindows)
-    {
-      if(toolWindow->objectName() == objectName)
-      {
-        t = toolWindow;
-        break;
-      }
-    }
+    QWidget *t = m_manager->toolWindowByName(objectName);
     if(t == NULL)
       t = m_manager->createToolWindow(objectName);
     if(t)
     {
-      t->setProperty("persistData", objectData[QStringLiteral("data")]);
+      m_manager->restoreToolWindowPersistData(t, objectData[QStringLiteral("data")]);
       addToolWindow(t);
     }
     else
@@ -353,7 +493,7 @@ void ToolWindowManagerArea::check_mouse_move()
     for(int i = 0; i < count(); i++)
     {
       QWidget *toolWindow = widget(i);
-      if(!m_manager->m_toolWindows.contains(toolWindow))
+      if(!m_manager->isToolWindow(toolWindow))
       {
         qWarning("tab widget contains unmanaged widget");
       }
@@ -368,11 +508,10 @@ void ToolWindowManagerArea::check_mouse_move()
 
 bool ToolWindowManagerArea::useMinimalTabBar()
 {
-  QWidget *w = widget(0);
-  if(w == NULL)
+  if(count() == 0)
     return false;
 
-  return (m_manager->toolWindowProperties(w) & ToolWindowManager::AlwaysDisplayFullTabs) == 0;
+  return (tabProperties(0) & ToolWindowManager::AlwaysDisplayFullTabs) == 0;
 }
 
 void ToolWindowManagerArea::tabMoved(int from, int to)
@@ -380,26 +519,13 @@ void ToolWindowManagerArea::tabMoved(int from, int to)
   if(m_inTabMoved)
     return;
 
-  // update the select order.
-  // This amounts to just a swap - any indices other than the pair in question are unaffected since
-  // one tab is removed (above/below) and added (below/above) so the indices themselves remain the
-  // same.
-  for(int &idx : m_tabSelectOrder)
-  {
-    if(idx == from)
-      idx = to;
-    else if(idx == to)
-      idx = from;
-  }
-
-  QWidget *a = widget(from);
-  QWidget *b = widget(to);
+  // the select order is kept by tool window rather than by index, so moving tabs doesn't affect it
 
-  if(!a || !b)
+  if(!widget(from) || !widget(to))
     return;
 
-  if(m_manager->toolWindowProperties(a) & ToolWindowManager::DisableDraggableTab ||
-     m_manager->toolWindowProperties(b) & ToolWindowManager::DisableDraggableTab)
+  if(tabProperties(from) & ToolWindowManager::DisableDraggableTab ||
+     tabProperties(to) & ToolWindowManager::DisableDraggableTab)
   {
     m_inTabMoved = true;
     tabBar()->moveTab(to, from);
@@ -25,11 +25,13 @@
 #ifndef TOOLWINDOWMANAGERAREA_H
 #define TOOLWINDOWMANAGERAREA_H
 
+#include <QHash>
 #include <QTabWidget>
 #include <QVariantMap>
+#include "ToolWindowManager.h"
 
-class ToolWindowManager;
 class ToolWindowManagerTabBar;
+class ToolWindowManagerWrapper;
 
 /*!
  * \brief The ToolWindowManagerArea class is a tab widget used to store tool windows.
@@ -62,13 +64,34 @@ public:
    */
   QList<QWidget *> toolWindows();
 
+  /*!
+   * Returns the tool window whose tab was selected most recently, or 0 if the area is empty.
+   */
+  QWidget *mostRecentToolWindow() const { return m_mostRecent; }
+  /*!
+   * Returns the tool window whose tab was selected last before \a toolWindow's, or 0 if there
+   * is none.
+   */
+  QWidget *lessRecentToolWindow(QWidget *toolWindow) const
+  {
+    return m_selectOrder.value(toolWindow).lessRecent;
+  }
+  /*!
+   * Returns all tool windows in this area, with the most recently selected one first.
+   */
+  QList<QWidget *> recentToolWindows() const;
+
   ToolWindowManager *manager() { return m_manager; }
+  //! Returns the wrapper this area is in, or 0 if it isn't in one.
+  ToolWindowManagerWrapper *wrapper();
   /*!
    * Updates the \a toolWindow to its current properties and title.
    */
   void updateToolWindow(QWidget *toolWindow);
 
 protected:
+  //! Reimplemented from QTabWidget::event.
+  virtual bool event(QEvent *event);
   //! Reimplemented from QTabWidget::mouseMoveEvent.
   virtual void mouseMoveEvent(QMouseEvent *);
   //! Reimplemented from QTabWidget::eventFilter.
@@ -82,6 +105,9 @@ protected:
 private:
   ToolWindowManager *m_manager;
   ToolWindowManagerTabBar *m_tabBar;
+  // cached by wrapper(), reset when reparented
+  ToolWindowManagerWrapper *m_wrapper;
+  bool m_layoutDirty;    // in the manager's list of areas to simplify
   bool m_dragCanStart;         // indicates that user has started mouse movement on QTabWidget
                                // that can be considered as dragging it if the cursor will leave
                                // its area
@@ -96,10 +122,40 @@ private:
   bool m_inTabMoved;    // if we're in the tabMoved() function (so if we call tabMove to cancel
                         // the movement, we shouldn't re-check the tabMoved behaviour)
 
-  QVector<int>
-      m_tabSelectOrder;    // This is the 'history' order of the tabs as they were selected,
-                           // with most recently selected index last. Any time a tab is closed
-                           // we select the last one on the list.
+  // This is the 'history' order of the tabs as they were selected, as a list linked through the
+  // tool windows with the most recently selected one at the front. Any time a tab is closed we
+  // select the next one on the list.
+  struct SelectOrderLink
+  {
+    QWidget *moreRecent;
+    QWidget *lessRecent;
+  };
+  QHash<QWidget *, SelectOrderLink> m_selectOrder;
+  QWidget *m_mostRecent;
+  // insert toolWindow after moreRecent, or at the front if moreRecent is 0
+  void linkSelectOrder(QWidget *toolWindow, QWidget *moreRecent);
+  void unlinkSelectOrder(QWidget *toolWindow);
+
+  // the record of the tool window in the tab at index, through the handle kept in the tab's data
+  // since tabInserted(), or NULL if it isn't an added tool window
+  ToolWindowManager::ToolWindowRecord *tabRecord(int index);
+  ToolWindowManager::ToolWindowProperty tabProperties(int index);
+
+  // show or hide the close button on the tab at index according to its tool window's properties
+  void updateCloseButton(int index);
+
+  // reset to the state of a new area before going into the manager's pool
+  void recycle();
+  // created by the default ToolWindowManager::createArea(), so it may be pooled and handed out by
+  // it again
+  bool m_poolable;
+
+  // unparent the tool windows of removed tabs, which removing the tab leaves in the tab widget's
+  // stack, so they aren't deleted or moved along with the area
+  void releaseHiddenToolWindows();
+
+  // remove the tab for toolWindow
+  void removeToolWindow(QWidget *toolWindow);
 
   QVariantMap saveState();                       // dump contents to variable
   void restoreState(const QVariantMap &data);    // restore contents from given variable
@@ -0,0 +1,119 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "ToolWindowManagerOverlay.h"
+#include <QPainter>
+#include <QPaintEvent>
+
+ToolWindowManagerOverlay::ToolWindowManagerOverlay(ToolWindowManager *manager)
+    : QWidget(NULL), m_manager(manager)
+{
+  setWindowFlags(Qt::Tool | Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint |
+                 Qt::X11BypassWindowManagerHint | Qt::WindowTransparentForInput |
+                 Qt::WindowDoesNotAcceptFocus);
+  setAttribute(Qt::WA_TranslucentBackground);
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+  setAttribute(Qt::WA_ShowWithoutActivating);
+  setAttribute(Qt::WA_AlwaysStackOnTop);
+}
+
+ToolWindowManagerOverlay::~ToolWindowManagerOverlay()
+{
+}
+
+void ToolWindowManagerOverlay::setDragState(
+    const QRect &preview, const QRect &tabPreview,
+    const QRect (&hotspots)[ToolWindowManager::NumReferenceTypes])
+{
+  const QRect screenRect = geometry();
+  const QPoint offset = -screenRect.topLeft();
+
+  QRegion dirty;
+
+  // clip to the screen and move into local coordinates, and accumulate the area that changed
+  auto apply = [&](QRect &current, const QRect &global) {
+    QRect r = global.intersects(screenRect) ? global.translated(offset) : QRect();
+    if(r != current)
+    {
+      dirty += current;
+      dirty += r;
+      current = r;
+    }
+  };
+
+  apply(m_preview, preview);
+  apply(m_tabPreview, tabPreview);
+  for(int i = 0; i < ToolWindowManager::NumReferenceTypes; i++)
+    apply(m_hotspots[i], hotspots[i]);
+
+  if(!dirty.isEmpty())
+    update(dirty);
+}
+
+bool ToolWindowManagerOverlay::hasContent() const
+{
+  if(!m_preview.isEmpty() || !m_tabPreview.isEmpty())
+    return true;
+
+  for(const QRect &hotspot : m_hotspots)
+  {
+    if(!hotspot.isEmpty())
+      return true;
+  }
+
+  return false;
+}
+
+void ToolWindowManagerOverlay::setBounds(const QRect &rect)
+{
+  if(rect == geometry())
+    return;
+
+  // the whole overlay is repainted after a resize, so there's nothing to keep
+  setGeometry(rect);
+  m_preview = m_tabPreview = QRect();
+  for(QRect &hotspot : m_hotspots)
+    hotspot = QRect();
+}
+
+void ToolWindowManagerOverlay::paintEvent(QPaintEvent *event)
+{
+  QPainter p(this);
+
+  // the previews are drawn semi-transparently in the highlight colour
+  QColor highlight = m_manager->palette().color(QPalette::Highlight);
+  highlight.setAlphaF(0.3);
+
+  if(!m_preview.isEmpty())
+    p.fillRect(m_preview, highlight);
+  if(!m_tabPreview.isEmpty())
+    p.fillRect(m_tabPreview, highlight);
+
+  // hotspots are drawn on top of the previews
+  for(int i = 0; i < ToolWindowManager::NumReferenceTypes; i++)
+  {
+    if(!m_hotspots[i].isEmpty() && m_hotspots[i].intersects(event->rect()))
+      p.drawPixmap(m_hotspots[i], m_manager->m_pixmaps[i]);
+  }
+}
@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef TOOLWINDOWMANAGEROVERLAY_H
+#define TOOLWINDOWMANAGEROVERLAY_H
+
+#include <QWidget>
+#include "ToolWindowManager.h"
+
+/*!
+ * \brief The ToolWindowManagerOverlay class is a transparent window covering the wrappers on one
+ * screen, used by ToolWindowManager to paint the drop preview and the drop hotspots during a drag.
+ *
+ * All of the drag feedback on a screen is painted in a single pass, instead of moving and raising
+ * a separate top level window for each preview rect and hotspot icon.
+ */
+class ToolWindowManagerOverlay : public QWidget
+{
+  Q_OBJECT
+public:
+  //! Creates an overlay drawing the hotspot pixmaps of \a manager.
+  explicit ToolWindowManagerOverlay(ToolWindowManager *manager);
+  //! Destroys the overlay.
+  virtual ~ToolWindowManagerOverlay();
+
+  /*!
+   * Sets the preview rect, the tab preview rect and the rect of each hotspot, all in global
+   * coordinates. Empty rects are not drawn. Only the parts that changed are repainted.
+   */
+  void setDragState(const QRect &preview, const QRect &tabPreview,
+                    const QRect (&hotspots)[ToolWindowManager::NumReferenceTypes]);
+
+  //! Returns true if anything set by setDragState is on this overlay.
+  bool hasContent() const;
+
+  /*!
+   * Moves the overlay to cover \a rect, in global coordinates. Anything set by setDragState has
+   * to be set again afterwards.
+   */
+  void setBounds(const QRect &rect);
+
+protected:
+  //! Reimplemented to paint the previews and hotspots.
+  void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE;
+
+private:
+  ToolWindowManager *m_manager;
+
+  // everything below is in local coordinates
+  QRect m_preview;
+  QRect m_tabPreview;
+  QRect m_hotspots[ToolWindowManager::NumReferenceTypes];
+};
+
+#endif    // TOOLWINDOWMANAGEROVERLAY_H
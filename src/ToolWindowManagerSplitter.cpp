@@ -25,55 +25,189 @@
 #include "ToolWindowManagerSplitter.h"
 #include <QChildEvent>
 #include <QDebug>
+#include "ToolWindowManager.h"
 
 ToolWindowManagerSplitter::ToolWindowManagerSplitter(QWidget *parent) : QSplitter(parent)
 {
+  m_removalPolicy = ShareWithNeighbours;
+  m_sizesPending = false;
+  m_poolable = false;
 }
 
 ToolWindowManagerSplitter::~ToolWindowManagerSplitter()
 {
 }
 
-void ToolWindowManagerSplitter::childEvent(QChildEvent *event)
+void ToolWindowManagerSplitter::setPinned(QWidget *widget, bool pinned)
+{
+  if(indexOf(widget) < 0)
+  {
+    qWarning("not a child of this splitter");
+    return;
+  }
+  if(pinned)
+    m_pinned.insert(widget);
+  else
+    m_pinned.remove(widget);
+}
+
+ToolWindowManager *ToolWindowManagerSplitter::manager() const
+{
+  for(QWidget *parent = parentWidget(); parent; parent = parent->parentWidget())
+  {
+    if(ToolWindowManager *manager = qobject_cast<ToolWindowManager *>(parent))
+      return manager;
+  }
+  return NULL;
+}
+
+QList<int> ToolWindowManagerSplitter::effectiveSizes() const
 {
   QList<int> s = sizes();
+  if(m_sizesPending)
+  {
+    for(int i = 0; i < s.count(); i++)
+      s[i] = m_pendingSizes.value(widget(i), s[i]);
+  }
+  return s;
+}
+
+void ToolWindowManagerSplitter::applyPendingSizes()
+{
+  if(!m_sizesPending)
+    return;
+
+  QList<int> s = effectiveSizes();
+  discardPendingSizes();
+  setSizes(s);
+}
+
+void ToolWindowManagerSplitter::discardPendingSizes()
+{
+  m_sizesPending = false;
+  m_pendingSizes.clear();
+}
+
+void ToolWindowManagerSplitter::recycle()
+{
+  m_removalPolicy = ShareWithNeighbours;
+  m_pinned.clear();
+  discardPendingSizes();
+}
+
+void ToolWindowManagerSplitter::childEvent(QChildEvent *event)
+{
+  // only removals are redistributed, everything else is left to QSplitter. Pending sizes are kept
+  // by child, so children added during a batch don't disturb them.
+  if(event->type() != QEvent::ChildRemoved || !event->child()->isWidgetType())
+  {
+    QSplitter::childEvent(event);
+    return;
+  }
 
-  QWidget *w = qobject_cast<QWidget *>(event->child());
-  int idx = -1;
-  if(w)
-    idx = indexOf(w);
+  // the child may be partway through being deleted, so it's only looked up by address
+  QWidget *w = static_cast<QWidget *>(event->child());
+  int idx = indexOf(w);
+  m_pinned.remove(w);
+
+  QList<int> s = effectiveSizes();
+  m_pendingSizes.remove(w);
 
   QSplitter::childEvent(event);
 
-  if(event->type() == QEvent::ChildRemoved && idx >= 0 && idx < s.count())
+  if(idx < 0 || idx >= s.count())
+    return;
+
+  redistribute(s, idx);
+
+  ToolWindowManager *manager = this->manager();
+  if(manager && manager->m_removalBatchDepth > 0 && s.count() == count())
+  {
+    if(!m_sizesPending)
+      manager->m_pendingSplitters << this;
+    m_sizesPending = true;
+    m_pendingSizes.clear();
+    for(int i = 0; i < s.count(); i++)
+      m_pendingSizes[widget(i)] = s[i];
+  }
+  else
   {
-    int removedSize = s[idx];
+    discardPendingSizes();
+    setSizes(s);
+  }
+}
 
-    s.removeAt(idx);
+void ToolWindowManagerSplitter::redistribute(QList<int> &s, int idx)
+{
+  int removedSize = s.takeAt(idx);
 
-    // if we removed an item at one extreme or another, the new end should get all the space
-    // (unless the list is now empty)
-    if(idx == 0)
-    {
-      if(!s.isEmpty())
+  // nothing to give the space to
+  if(s.isEmpty())
+    return;
+
+  switch(m_removalPolicy)
+  {
+    case Proportional: shareProportionally(s, removedSize, false); break;
+    case FixedPinned: shareProportionally(s, removedSize, true); break;
+    case NeighbourTakesAll:
+      if(idx > 0)
+        s[idx - 1] += removedSize;
+      else
+        s[0] += removedSize;
+      break;
+    case ShareWithNeighbours:
+    default:
+      // if we removed an item at one extreme or another, the new end should get all the space
+      if(idx == 0)
+      {
         s[0] += removedSize;
-    }
-    else if(idx == s.count())
-    {
-      if(!s.isEmpty())
+      }
+      else if(idx == s.count())
+      {
         s[s.count() - 1] += removedSize;
-    }
-    else
-    {
-      // we removed an item in the middle, share the space between its previous neighbours, now in
-      // [idx-1] and [idx], and we know they're valid since if there were only two elements before
-      // the removal one or the other case above would have matched. So there are at least two
-      // elements now and idx > 0
-
-      s[idx - 1] += removedSize / 2;
-      s[idx] += removedSize / 2;
-    }
+      }
+      else
+      {
+        // we removed an item in the middle, share the space between its previous neighbours, now
+        // in [idx-1] and [idx], and we know they're valid since if there were only two elements
+        // before the removal one or the other case above would have matched. So there are at
+        // least two elements now and idx > 0
 
-    setSizes(s);
+        s[idx - 1] += removedSize / 2;
+        s[idx] += removedSize / 2;
+      }
+      break;
   }
 }
+
+void ToolWindowManagerSplitter::shareProportionally(QList<int> &s, int space, bool skipPinned)
+{
+  // s lines up with the remaining children, since the removed one is already gone
+  QList<int> eligible;
+  qint64 total = 0;
+  for(int i = 0; i < s.count(); i++)
+  {
+    if(skipPinned && m_pinned.contains(widget(i)))
+      continue;
+    eligible << i;
+    total += s[i];
+  }
+
+  // if everything is pinned, everything grows
+  if(eligible.isEmpty())
+  {
+    shareProportionally(s, space, false);
+    return;
+  }
+
+  int given = 0;
+  foreach(int i, eligible)
+  {
+    int share = total > 0 ? int(qint64(space) * s[i] / total) : space / eligible.count();
+    s[i] += share;
+    given += share;
+  }
+
+  // rounding leftovers go to the last one
+  s[eligible.last()] += space - given;
+}
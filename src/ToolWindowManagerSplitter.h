@@ -25,8 +25,12 @@
 #ifndef TOOLWINDOWMANAGERSPLITTER_H
 #define TOOLWINDOWMANAGERSPLITTER_H
 
+#include <QHash>
+#include <QSet>
 #include <QSplitter>
 
+class ToolWindowManager;
+
 /*!
  * \brief The ToolWindowManagerSplitter class is a splitter that tweaks how sizes are allocated in
  * children when a child is removed.
@@ -40,9 +44,64 @@ public:
   //! Destroys the tab bar.
   virtual ~ToolWindowManagerSplitter();
 
+  //! How the space of a removed child is given to the remaining ones.
+  enum RemovalPolicy
+  {
+    //! The neighbours on either side share the space, or the one neighbour at either end takes it.
+    ShareWithNeighbours,
+    //! All remaining children grow in proportion to their sizes.
+    Proportional,
+    //! The previous neighbour takes all the space, or the next one if the first child is removed.
+    NeighbourTakesAll,
+    //! Pinned children keep their size, the others grow in proportion to their sizes.
+    FixedPinned,
+  };
+
+  void setRemovalPolicy(RemovalPolicy policy) { m_removalPolicy = policy; }
+  RemovalPolicy removalPolicy() const { return m_removalPolicy; }
+
+  /*!
+   * Pins or unpins the child \a widget. Pinned children keep their size when another child is
+   * removed under the FixedPinned policy.
+   */
+  void setPinned(QWidget *widget, bool pinned);
+  bool isPinned(QWidget *widget) const { return m_pinned.contains(widget); }
+
 protected:
   //! Reimplemented from QSplitter to share excess space differently.
   void childEvent(QChildEvent *) Q_DECL_OVERRIDE;
+
+private:
+  RemovalPolicy m_removalPolicy;
+  QSet<QWidget *> m_pinned;
+
+  // give the space of the child at index to the others in sizes according to the policy
+  void redistribute(QList<int> &sizes, int index);
+  // share space between the children in sizes in proportion to their sizes, skipping pinned ones
+  // if there are any others
+  void shareProportionally(QList<int> &sizes, int space, bool skipPinned);
+
+  // while the manager this splitter is in has a removal batch open, the sizes worked out for
+  // removed children are kept by child until the batch ends. Children added in the meantime keep
+  // the size the splitter gives them.
+  bool m_sizesPending;
+  QHash<QWidget *, int> m_pendingSizes;
+  // the closest manager above this splitter, or 0 if it's not in a manager's layout
+  ToolWindowManager *manager() const;
+  // the current sizes with the pending ones in place of those they were worked out for
+  QList<int> effectiveSizes() const;
+  void applyPendingSizes();
+  // drop the pending sizes, for when sizes are about to be set explicitly
+  void discardPendingSizes();
+
+  // reset to the state of a new splitter before going into the manager's pool
+  void recycle();
+
+  // created by the default ToolWindowManager::createSplitter(), so it may be pooled and handed out
+  // by it again
+  bool m_poolable;
+
+  friend class ToolWindowManager;
 };
 
 #endif    // TOOLWINDOWMANAGERSPLITTER_H
@@ -166,8 +166,7 @@ void ToolWindowManagerTabBar::paintEvent(QPaintEvent *event)
     buttonOpt.rect = m_pin.rect;
     buttonOpt.icon = m_pin.icon;
 
-    ToolWindowManager::ToolWindowProperty props =
-        m_area->m_manager->toolWindowProperties(m_area->widget(0));
+    ToolWindowManager::ToolWindowProperty props = m_area->tabProperties(0);
 
     bool tabClosable = (props & ToolWindowManager::HideCloseButton) == 0;
 
@@ -243,8 +242,7 @@ void ToolWindowManagerTabBar::mousePressEvent(QMouseEvent *event)
   ButtonData prevPin = m_pin;
   ButtonData prevClose = m_close;
 
-  ToolWindowManager::ToolWindowProperty props =
-      m_area->m_manager->toolWindowProperties(m_area->widget(0));
+  ToolWindowManager::ToolWindowProperty props = m_area->tabProperties(0);
 
   bool tabClosable = (props & ToolWindowManager::HideCloseButton) == 0;
 
@@ -292,8 +290,7 @@ void ToolWindowManagerTabBar::mouseMoveEvent(QMouseEvent *event)
   ButtonData prevPin = m_pin;
   ButtonData prevClose = m_close;
 
-  ToolWindowManager::ToolWindowProperty props =
-      m_area->m_manager->toolWindowProperties(m_area->widget(0));
+  ToolWindowManager::ToolWindowProperty props = m_area->tabProperties(0);
 
   bool tabClosable = (props & ToolWindowManager::HideCloseButton) == 0;
 
@@ -353,8 +350,7 @@ void ToolWindowManagerTabBar::mouseReleaseEvent(QMouseEvent *event)
   if(count() > 1 || floatingWindowChild())
     return;
 
-  ToolWindowManager::ToolWindowProperty props =
-      m_area->m_manager->toolWindowProperties(m_area->widget(0));
+  ToolWindowManager::ToolWindowProperty props = m_area->tabProperties(0);
 
   bool tabClosable = (props & ToolWindowManager::HideCloseButton) == 0;
 
@@ -64,6 +64,11 @@ ToolWindowManagerWrapper::ToolWindowManagerWrapper(ToolWindowManager *manager, b
   mainLayout->setMargin(0);
   mainLayout->setSpacing(0);
   m_manager->m_wrappers << this;
+  // new floating windows are shown on top of the existing ones
+  if(floating)
+    m_manager->m_wrapperZOrder.prepend(this);
+  else
+    m_manager->m_wrapperZOrder.append(this);
 
   m_moveTimeout = new QTimer(this);
   m_moveTimeout->setInterval(100);
@@ -99,6 +104,34 @@ ToolWindowManagerWrapper::ToolWindowManagerWrapper(ToolWindowManager *manager, b
 ToolWindowManagerWrapper::~ToolWindowManagerWrapper()
 {
   m_manager->m_wrappers.removeOne(this);
+  m_manager->m_wrapperZOrder.removeOne(this);
+}
+
+QList<QWidget *> ToolWindowManagerWrapper::toolWindows()
+{
+  QList<QWidget *> result;
+  collectToolWindows(rootWidget(), result);
+  return result;
+}
+
+void ToolWindowManagerWrapper::collectToolWindows(QWidget *widget, QList<QWidget *> &result)
+{
+  if(QSplitter *splitter = qobject_cast<QSplitter *>(widget))
+  {
+    for(int i = 0; i < splitter->count(); i++)
+      collectToolWindows(splitter->widget(i), result);
+  }
+  else if(ToolWindowManagerArea *area = qobject_cast<ToolWindowManagerArea *>(widget))
+  {
+    // areas aren't descended into, so a manager nested in a tool window is never reached
+    result << area->toolWindows();
+  }
+}
+
+QWidget *ToolWindowManagerWrapper::rootWidget()
+{
+  QLayoutItem *item = layout()->itemAt(0);
+  return item ? item->widget() : NULL;
 }
 
 void ToolWindowManagerWrapper::updateTitle()
@@ -109,7 +142,7 @@ void ToolWindowManagerWrapper::updateTitle()
   // find the best candidate for a 'title' for this floating window.
   if(layout()->count() > 0)
   {
-    QWidget *child = layout()->itemAt(0)->widget();
+    QWidget *child = rootWidget();
 
     while(child)
     {
@@ -165,14 +198,7 @@ void ToolWindowManagerWrapper::closeEvent(QCloseEvent *event)
   // abort dragging caused by QEvent::NonClientAreaMouseButtonPress in eventFilter function
   m_manager->abortDrag();
 
-  QList<QWidget *> toolWindows;
-  foreach(ToolWindowManagerArea *tabWidget, findChildren<ToolWindowManagerArea *>())
-  {
-    if(ToolWindowManager::managerOf(tabWidget) == m_manager)
-    {
-      toolWindows << tabWidget->toolWindows();
-    }
-  }
+  QList<QWidget *> toolWindows = this->toolWindows();
 
   foreach(QWidget *toolWindow, toolWindows)
   {
@@ -229,15 +255,7 @@ bool ToolWindowManagerWrapper::eventFilter(QObject *object, QEvent *event)
         {
           m_dragActive = true;
           m_dragReady = false;
-          QList<QWidget *> toolWindows;
-          foreach(ToolWindowManagerArea *tabWidget, findChildren<ToolWindowManagerArea *>())
-          {
-            if(ToolWindowManager::managerOf(tabWidget) == m_manager)
-            {
-              toolWindows << tabWidget->toolWindows();
-            }
-          }
-          m_manager->startDrag(toolWindows, this);
+          m_manager->startDrag(toolWindows(), this);
         }
       }
       // if the drag is active, update it in the manager.
@@ -317,15 +335,7 @@ bool ToolWindowManagerWrapper::eventFilter(QObject *object, QEvent *event)
       m_dragReady = false;
       m_dragStartCursor = QCursor::pos();
       m_dragStartGeometry = geometry();
-      QList<QWidget *> toolWindows;
-      foreach(ToolWindowManagerArea *tabWidget, findChildren<ToolWindowManagerArea *>())
-      {
-        if(ToolWindowManager::managerOf(tabWidget) == m_manager)
-        {
-          toolWindows << tabWidget->toolWindows();
-        }
-      }
-      m_manager->startDrag(toolWindows, this);
+      m_manager->startDrag(toolWindows(), this);
     }
     else if(event->type() == QEvent::Move && m_dragActive)
     {
@@ -336,6 +346,11 @@ bool ToolWindowManagerWrapper::eventFilter(QObject *object, QEvent *event)
     {
       unsetCursor();
     }
+    else if(event->type() == QEvent::WindowActivate || event->type() == QEvent::Show)
+    {
+      // activating or showing the window raises it above the other floating windows
+      m_manager->raiseWrapper(this);
+    }
     else if(event->type() == QEvent::MouseButtonDblClick &&
             titleRect().contains(mapFromGlobal(QCursor::pos())))
     {
@@ -420,6 +435,7 @@ void ToolWindowManagerWrapper::resizeEvent(QResizeEvent *)
 {
   // abort dragging caused by QEvent::NonClientAreaMouseButtonPress in eventFilter function
   m_manager->abortDrag();
+  m_manager->invalidateDragHitCache();
 
   QStyleOptionDockWidget option;
 
@@ -433,6 +449,13 @@ void ToolWindowManagerWrapper::resizeEvent(QResizeEvent *)
   m_closeIcon = style()->standardIcon(QStyle::SP_TitleBarCloseButton, &option, this);
 }
 
+void ToolWindowManagerWrapper::moveEvent(QMoveEvent *)
+{
+  // the wrapper being dragged is never a drop target, so moving it doesn't affect hit-testing
+  if(m_manager->m_draggedWrapper != this)
+    m_manager->invalidateDragHitCache();
+}
+
 QRect ToolWindowManagerWrapper::titleRect()
 {
   QRect ret;
@@ -457,14 +480,15 @@ QVariantMap ToolWindowManagerWrapper::saveState()
   }
   QVariantMap result;
   result[QStringLiteral("geometry")] = saveGeometry().toBase64();
-  QSplitter *splitter = findChild<QSplitter *>(QString(), Qt::FindDirectChildrenOnly);
+  QWidget *root = rootWidget();
+  QSplitter *splitter = qobject_cast<QSplitter *>(root);
   if(splitter)
   {
     result[QStringLiteral("splitter")] = m_manager->saveSplitterState(splitter);
   }
   else
   {
-    ToolWindowManagerArea *area = findChild<ToolWindowManagerArea *>();
+    ToolWindowManagerArea *area = qobject_cast<ToolWindowManagerArea *>(root);
     if(area)
     {
       result[QStringLiteral("area")] = area->saveState();
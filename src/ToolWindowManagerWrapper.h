@@ -50,6 +50,10 @@ public:
 
   ToolWindowManager *manager() { return m_manager; }
   bool floating() { return m_floating; }
+  //! Returns all tool windows in the areas of this wrapper, in layout order.
+  QList<QWidget *> toolWindows();
+  //! Returns the splitter or area at the root of this wrapper's layout, or 0 if it's empty.
+  QWidget *rootWidget();
   void updateTitle();
 
 protected:
@@ -64,6 +68,9 @@ protected:
   virtual void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE;
   virtual void resizeEvent(QResizeEvent *) Q_DECL_OVERRIDE;
 
+  //! Reimplemented to invalidate the manager's cached drop target geometry
+  virtual void moveEvent(QMoveEvent *) Q_DECL_OVERRIDE;
+
 private:
   ToolWindowManager *m_manager;
 
@@ -104,6 +111,9 @@ private:
   // construct layout based on given dump
   void restoreState(const QVariantMap &data);
 
+  // append the tool windows of our areas under widget, depth first in layout order
+  void collectToolWindows(QWidget *widget, QList<QWidget *> &result);
+
   friend class ToolWindowManager;
 
 private slots: